@@ -13,10 +13,41 @@ os_status_t yield(void);
 
 os_status_t mbx_send(os_task_id_t dest_id, os_mbx_msg_t msg);
 
+os_status_t mbx_send_wait(os_task_id_t dest_id, os_mbx_msg_t msg);
+
 os_status_t mbx_recv(os_task_id_t *src_id, os_mbx_msg_t *msg);
 
+os_status_t mbx_query(os_mbx_query_t *query);
+
+os_status_t mbx_wait_recv(os_mbx_mask_t mask, os_task_id_t *src_id,
+                          os_mbx_msg_t *msg);
+
+os_status_t mbx_send_batch(const os_mbx_send_entry_t *mbx, uint32_t count,
+                           os_status_t *status);
+
+os_status_t mbx_recv_batch(os_mbx_entry_t *mbx, uint32_t count,
+                           uint32_t *received);
+
+os_status_t mbx_call(os_task_id_t dest_id, os_mbx_msg_t msg,
+                     os_task_id_t *src_id, os_mbx_msg_t *answer);
+
+os_status_t mbx_reply_wait(os_task_id_t dest_id, os_mbx_msg_t answer,
+                           os_mbx_mask_t mask, os_task_id_t *src_id,
+                           os_mbx_msg_t *msg);
+
+os_status_t notify(os_task_id_t dest_id, uint32_t bits);
+
+os_status_t notify_wait(uint32_t *bits);
+
+os_status_t irq_ack(uint32_t irq);
+
 void exit(int reason);
 
+#if defined(CONFIG_APP_FPU_CHECK)
+os_status_t fpu_check_wait(os_mbx_mask_t mask, uint32_t seed,
+                           uint32_t *errors);
+#endif
+
 os_task_id_t getpid(void);
 
 int main(int argc, char **argv, char **argp);
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * @file fpu_check_wait.c
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief wait system call with a check of the FPU registers
+ */
+
+#include <moth.h>
+
+#define FPU_CHECK_REG_CNT 32
+
+os_status_t fpu_check_wait(os_mbx_mask_t mask, uint32_t seed,
+                           uint32_t *errors) {
+  uint32_t before[FPU_CHECK_REG_CNT] __attribute__((aligned(8)));
+  uint32_t after[FPU_CHECK_REG_CNT] __attribute__((aligned(8)));
+  register uint32_t o0 asm("o0") = OS_MBX_MASK_TO_REG(mask);
+  uint32_t i;
+
+  for (i = 0; i < FPU_CHECK_REG_CNT; i++) {
+    before[i] = (seed << 8) | i;
+  }
+
+  /*
+   * Fill the FPU registers, wait for a mbx (other tasks run and may use
+   * the FPU meanwhile) and read the FPU registers back. This is a single
+   * asm statement so that the compiler cannot use the FPU registers in
+   * between. The trap may change the out and global registers.
+   */
+  asm volatile("ldd [%1 + 0], %%f0\n"
+               "ldd [%1 + 8], %%f2\n"
+               "ldd [%1 + 16], %%f4\n"
+               "ldd [%1 + 24], %%f6\n"
+               "ldd [%1 + 32], %%f8\n"
+               "ldd [%1 + 40], %%f10\n"
+               "ldd [%1 + 48], %%f12\n"
+               "ldd [%1 + 56], %%f14\n"
+               "ldd [%1 + 64], %%f16\n"
+               "ldd [%1 + 72], %%f18\n"
+               "ldd [%1 + 80], %%f20\n"
+               "ldd [%1 + 88], %%f22\n"
+               "ldd [%1 + 96], %%f24\n"
+               "ldd [%1 + 104], %%f26\n"
+               "ldd [%1 + 112], %%f28\n"
+               "ldd [%1 + 120], %%f30\n"
+               "ta 0x00\n"
+               "nop\n"
+               "std %%f0, [%2 + 0]\n"
+               "std %%f2, [%2 + 8]\n"
+               "std %%f4, [%2 + 16]\n"
+               "std %%f6, [%2 + 24]\n"
+               "std %%f8, [%2 + 32]\n"
+               "std %%f10, [%2 + 40]\n"
+               "std %%f12, [%2 + 48]\n"
+               "std %%f14, [%2 + 56]\n"
+               "std %%f16, [%2 + 64]\n"
+               "std %%f18, [%2 + 72]\n"
+               "std %%f20, [%2 + 80]\n"
+               "std %%f22, [%2 + 88]\n"
+               "std %%f24, [%2 + 96]\n"
+               "std %%f26, [%2 + 104]\n"
+               "std %%f28, [%2 + 112]\n"
+               "std %%f30, [%2 + 120]\n"
+               : "+r"(o0)
+               : "r"(before), "r"(after)
+               : "memory", "cc", "o1", "o2", "o3", "o4", "o5", "o7", "g1",
+                 "g2", "g3", "g4",
+                 "f0", "f1", "f2", "f3", "f4", "f5", "f6", "f7", "f8", "f9",
+                 "f10", "f11", "f12", "f13", "f14", "f15", "f16", "f17", "f18",
+                 "f19", "f20", "f21", "f22", "f23", "f24", "f25", "f26", "f27",
+                 "f28", "f29", "f30", "f31");
+
+  *errors = 0;
+
+  for (i = 0; i < FPU_CHECK_REG_CNT; i++) {
+    if (after[i] != before[i]) {
+      (*errors)++;
+    }
+  }
+
+  return (os_status_t)o0;
+}
@@ -16,11 +16,21 @@
  * License along with this library; if not, write to the Free Software
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
- * @file mbx_recv.c
+ * @file irq_ack.c
  * @author Jean-Christophe Dubois (jcd@tribudubois.net)
- * @brief mbx_recv system call
+ * @brief irq_ack system call
  */
 
 #include <moth.h>
 
-__attribute__((section(".bss.entry"))) os_mbx_entry_t __mbx_entry;
+os_status_t irq_ack(uint32_t irq) {
+  register uint32_t o0 asm("o0") = irq;
+
+  asm volatile("ta 0x0e\n"
+               "nop\n"
+               : "+r"(o0)
+               :
+               : "memory");
+
+  return (os_status_t)o0;
+}
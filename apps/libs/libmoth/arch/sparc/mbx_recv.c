@@ -23,22 +23,20 @@
 
 #include <moth.h>
 
-extern os_mbx_entry_t __mbx_entry;
-
 os_status_t mbx_recv(os_task_id_t *sender_id, os_mbx_msg_t *msg) {
-  os_status_t status;
-
-  *sender_id = OS_TASK_ID_NONE;
-  *msg = 0;
+  register uint32_t o0 asm("o0");
+  register uint32_t o1 asm("o1");
+  register uint32_t o2 asm("o2");
+  register uint32_t o3 asm("o3");
 
   asm volatile("ta 0x03\n"
                "nop\n"
-               : "=r"(status)
+               : "=r"(o0), "=r"(o1), "=r"(o2), "=r"(o3)
                :
                : "memory");
 
-  *sender_id = __mbx_entry.sender_id;
-  *msg = __mbx_entry.msg;
+  *sender_id = (os_task_id_t)o1;
+  *msg = OS_MBX_MSG(o2, o3);
 
-  return status;
+  return (os_status_t)o0;
 }
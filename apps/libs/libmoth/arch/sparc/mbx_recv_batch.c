@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * @file mbx_recv_batch.c
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief mbx_recv_batch system call
+ */
+
+#include <moth.h>
+
+os_status_t mbx_recv_batch(os_mbx_entry_t *mbx, uint32_t count,
+                           uint32_t *received) {
+  register uint32_t o0 asm("o0") = (uint32_t)mbx;
+  register uint32_t o1 asm("o1") = count;
+
+  asm volatile("ta 0x09\n"
+               "nop\n"
+               : "+r"(o0), "+r"(o1)
+               :
+               : "memory");
+
+  *received = o1;
+
+  return (os_status_t)o0;
+}
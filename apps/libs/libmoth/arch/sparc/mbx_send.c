@@ -23,19 +23,16 @@
 
 #include <moth.h>
 
-extern os_mbx_entry_t __mbx_entry;
-
 os_status_t mbx_send(os_task_id_t dest_id, os_mbx_msg_t msg) {
-  os_status_t status;
-
-  __mbx_entry.sender_id = dest_id;
-  __mbx_entry.msg = msg;
+  register uint32_t o0 asm("o0") = (uint32_t)dest_id;
+  register uint32_t o1 asm("o1") = OS_MBX_MSG_HI(msg);
+  register uint32_t o2 asm("o2") = OS_MBX_MSG_LO(msg);
 
   asm volatile("ta 0x02\n"
                "nop\n"
-               : "=r"(status)
-               :
+               : "+r"(o0)
+               : "r"(o1), "r"(o2)
                : "memory");
 
-  return status;
+  return (os_status_t)o0;
 }
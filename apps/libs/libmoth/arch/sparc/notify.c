@@ -0,0 +1,38 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * @file notify.c
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief notify system call
+ */
+
+#include <moth.h>
+
+os_status_t notify(os_task_id_t dest_id, uint32_t bits) {
+  register uint32_t o0 asm("o0") = (uint32_t)dest_id;
+  register uint32_t o1 asm("o1") = bits;
+
+  asm volatile("ta 0x0a\n"
+               "nop\n"
+               : "+r"(o0)
+               : "r"(o1)
+               : "memory");
+
+  return (os_status_t)o0;
+}
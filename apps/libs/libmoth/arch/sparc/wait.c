@@ -24,14 +24,13 @@
 #include <moth.h>
 
 os_status_t wait(os_mbx_mask_t mask) {
-  os_status_t status;
-  (void)mask;
+  register uint32_t o0 asm("o0") = OS_MBX_MASK_TO_REG(mask);
 
   asm volatile("ta 0x00\n"
                "nop\n"
-               : "=r"(status)
+               : "+r"(o0)
                :
                : "memory");
 
-  return status;
+  return (os_status_t)o0;
 }
@@ -24,13 +24,13 @@
 #include <moth.h>
 
 os_status_t yield(void) {
-  os_status_t status;
+  register uint32_t o0 asm("o0");
 
   asm volatile("ta 0x01\n"
                "nop\n"
-               : "=r"(status)
+               : "=r"(o0)
                :
                : "memory");
 
-  return status;
+  return (os_status_t)o0;
 }
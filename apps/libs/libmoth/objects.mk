@@ -23,8 +23,18 @@
 
 apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/wait.o
 apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/yield.o
-apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx.o
 apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_send.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_send_wait.o
 apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_recv.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_query.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_wait_recv.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_send_batch.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_recv_batch.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_call.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/mbx_reply_wait.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/notify.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/notify_wait.o
+apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/irq_ack.o
 apps-libs-objs-$(CONFIG_LIBMOTH)+= libmoth/arch/$(CONFIG_ARCH)/exit.o
+apps-libs-objs-$(CONFIG_APP_FPU_CHECK)+= libmoth/arch/$(CONFIG_ARCH)/fpu_check_wait.o
 
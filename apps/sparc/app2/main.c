@@ -64,6 +64,10 @@ int main(int argc, char **argv, char **argp) {
   os_task_id_t tmp_id;
   os_mbx_msg_t msg;
   const os_task_id_t task_id = getpid();
+#if defined(CONFIG_APP_FPU_CHECK)
+  uint32_t fpu_round = 0;
+  uint32_t fpu_errors;
+#endif
 
   (void)argc;
   (void)argv;
@@ -78,33 +82,39 @@ int main(int argc, char **argv, char **argp) {
   while (1) {
     printf("task %d: waiting for mbx\n", (int)task_id);
 
-    cr = wait(OS_MBX_MASK_ALL);
+#if defined(CONFIG_APP_FPU_CHECK)
+    /* Keep our own pattern in the FPU while the other tasks run */
+    cr = fpu_check_wait(OS_MBX_MASK_ALL, ((uint32_t)task_id << 16) | fpu_round,
+                        &fpu_errors);
+    fpu_round++;
 
-    if (cr == OS_SUCCESS) {
-      cr = mbx_recv(&tmp_id, &msg);
+    if (fpu_errors != 0) {
+      printf("task %d: %d FPU registers lost (cr = %d)\n", (int)task_id,
+             (int)fpu_errors, (int)cr);
+    }
+#endif
 
-      if (cr == OS_SUCCESS) {
-        printf("task %d: mbx %d received from task %d\n", (int)task_id,
-               (int)msg, (int)tmp_id);
+    cr = mbx_wait_recv(OS_MBX_MASK_ALL, &tmp_id, &msg);
+
+    if (cr == OS_SUCCESS) {
+      printf("task %d: mbx %d received from task %d\n", (int)task_id,
+             (int)msg, (int)tmp_id);
 
-        if (tmp_id == OS_TIMER_TASK_ID) {
-          tmp_id = OS_APP3_TASK_ID;
+      if (tmp_id == OS_TIMER_TASK_ID) {
+        tmp_id = OS_APP3_TASK_ID;
 
-          cr = mbx_send(tmp_id, msg);
+        cr = mbx_send(tmp_id, msg);
 
-          if (cr == OS_SUCCESS) {
-            printf("task %d: mbx %d sent to task %d\n", (int)task_id, (int)msg,
-                   (int)tmp_id);
-          } else {
-            printf("task %d: mbx_send failed, cr = %d\n", (int)task_id,
-                   (int)cr);
-          }
+        if (cr == OS_SUCCESS) {
+          printf("task %d: mbx %d sent to task %d\n", (int)task_id, (int)msg,
+                 (int)tmp_id);
+        } else {
+          printf("task %d: mbx_send failed, cr = %d\n", (int)task_id,
+                 (int)cr);
         }
-      } else {
-        printf("task %d: mbx_recv failed, cr = %d\n", (int)task_id, (int)cr);
       }
     } else {
-      printf("task %d: wait failed, cr = %d\n", (int)task_id, (int)cr);
+      printf("task %d: mbx_wait_recv failed, cr = %d\n", (int)task_id, (int)cr);
     }
   }
 }
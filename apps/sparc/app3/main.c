@@ -78,39 +78,33 @@ int main(int argc, char **argv, char **argp) {
   while (1) {
     printf("task %d: waiting for mbx\n", (int)task_id);
 
-    cr = wait(OS_MBX_MASK_ALL);
+    cr = mbx_wait_recv(OS_MBX_MASK_ALL, &tmp_id, &msg);
 
     if (cr == OS_SUCCESS) {
-      cr = mbx_recv(&tmp_id, &msg);
+      printf("task %d: mbx %d received from task %d\n", (int)task_id,
+             (int)msg, (int)tmp_id);
+
+      switch (tmp_id) {
+      case OS_APP1_TASK_ID:
+        tmp_id = OS_APP2_TASK_ID;
+        break;
+      case OS_APP2_TASK_ID:
+        tmp_id = OS_APP1_TASK_ID;
+        break;
+      default:
+        break;
+      }
+
+      cr = mbx_send(tmp_id, msg);
 
       if (cr == OS_SUCCESS) {
-        printf("task %d: mbx %d received from task %d\n", (int)task_id,
-               (int)msg, (int)tmp_id);
-
-        switch (tmp_id) {
-        case OS_APP1_TASK_ID:
-          tmp_id = OS_APP2_TASK_ID;
-          break;
-        case OS_APP2_TASK_ID:
-          tmp_id = OS_APP1_TASK_ID;
-          break;
-        default:
-          break;
-        }
-
-        cr = mbx_send(tmp_id, msg);
-
-        if (cr == OS_SUCCESS) {
-          printf("task %d: mbx %d sent to task %d\n", (int)task_id, (int)msg,
-                 (int)tmp_id);
-        } else {
-          printf("task %d: mbx_send failed, cr = %d\n", (int)task_id, (int)cr);
-        }
+        printf("task %d: mbx %d sent to task %d\n", (int)task_id, (int)msg,
+               (int)tmp_id);
       } else {
-        printf("task %d: mbx_recv failed, cr = %d\n", (int)task_id, (int)cr);
+        printf("task %d: mbx_send failed, cr = %d\n", (int)task_id, (int)cr);
       }
     } else {
-      printf("task %d: wait failed, cr = %d\n", (int)task_id, (int)cr);
+      printf("task %d: mbx_wait_recv failed, cr = %d\n", (int)task_id, (int)cr);
     }
   }
 }
@@ -68,9 +68,9 @@ static const os_task_id_t interrupt_dest[14] = {
     OS_TASK_ID_NONE,  // interrupt 3
     OS_TASK_ID_NONE,  // interrupt 4
     OS_TASK_ID_NONE,  // interrupt 5
-    OS_TIMER_TASK_ID, // interrupt 6
+    OS_TASK_ID_NONE,  // interrupt 6 (timer, routed by the kernel)
     OS_TASK_ID_NONE,  // interrupt 7
-    OS_TIMER_TASK_ID, // interrupt 8
+    OS_TASK_ID_NONE,  // interrupt 8 (timer, routed by the kernel)
     OS_TASK_ID_NONE,  // interrupt 9
     OS_TASK_ID_NONE,  // interrupt 10
     OS_TASK_ID_NONE,  // interrupt 11
@@ -105,12 +105,10 @@ int main(int argc, char **argv, char **argp) {
   io_write32(uart_addr + UART_CTRL_OFFSET, UART_CTRL_TE);
 
   /*
-   * we don't need to enable the interrupts as we don't want to be
-   * interrupted
+   * The interrupt mask is managed by the kernel. Only the lines owned by a
+   * task are unmasked. The other ones are polled here.
    */
 
-  io_write32(pic_addr + IRQMP_MASK_OFFSET, 0xFFFFFFFF);
-
   printf("interrupt: init done\n");
 
   while (1) {
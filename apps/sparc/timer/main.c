@@ -87,12 +87,84 @@ static void putc(void *opaque, char car) {
   io_write8(uart_addr + UART_DATA_OFFSET, (uint8_t)car);
 }
 
+#if defined(CONFIG_APP_TIMER_SYSCALL_BENCH)
+/* Number of calls for each measured system call */
+#define BENCH_LOOP_COUNT 1000
+/* The counter is decremented every (BENCH_SCALLER + 1) clock cycles */
+#define BENCH_SCALLER 1
+
+static uint32_t bench_counter(uint32_t timer_addr) {
+  return io_read32(timer_addr + TIMER_BASE + COUNTER_OFFSET);
+}
+
+static void bench_report(const char *name, uint32_t start, uint32_t end) {
+  /* this is a down counter */
+  uint32_t cycles = (start - end) * (BENCH_SCALLER + 1);
+
+  printf("timer: %s: %d cycles/call\n", name,
+         (int)(cycles / BENCH_LOOP_COUNT));
+}
+
+/**
+ * Use the first timer as a free running counter to measure the trap to
+ * return time of the system calls that do not switch to another task.
+ */
+static void syscall_bench(uint32_t timer_addr) {
+  const os_task_id_t task_id = getpid();
+  os_mbx_mask_t self_mask = OS_MBX_MASK_NONE;
+  os_mbx_query_t query;
+  os_task_id_t sender_id;
+  os_mbx_msg_t msg;
+  uint32_t start;
+  uint32_t i;
+
+  io_write32(timer_addr + SCALER_OFFSET, BENCH_SCALLER);
+  io_write32(timer_addr + SCALER_RELOAD_OFFSET, BENCH_SCALLER);
+
+  io_write32(timer_addr + TIMER_BASE + COUNTER_OFFSET, 0xffffffff);
+  io_write32(timer_addr + TIMER_BASE + COUNTER_RELOAD_OFFSET, 0xffffffff);
+  io_write32(timer_addr + TIMER_BASE + CONFIG_OFFSET,
+             (uint32_t)(GPTIMER_ENABLE | GPTIMER_LOAD | GPTIMER_RESTART));
+
+  start = bench_counter(timer_addr);
+  for (i = 0; i < BENCH_LOOP_COUNT; i++) {
+    mbx_query(&query);
+  }
+  bench_report("mbx_query", start, bench_counter(timer_addr));
+
+  /*
+   * We accept our own mbx in this build (see mmugen.xml). Wait for the
+   * first one once so that the following receives are looking for it.
+   * Then each send posts a mbx that the next receive takes out of the
+   * FIFO.
+   */
+  self_mask.word[task_id / OS_MBX_MASK_WORD_SZ] =
+      OS_MBX_MASK_BIT(task_id / OS_MBX_MASK_WORD_SZ, task_id);
+  mbx_send(task_id, 0);
+  mbx_wait_recv(self_mask, &sender_id, &msg);
+
+  start = bench_counter(timer_addr);
+  for (i = 0; i < BENCH_LOOP_COUNT; i++) {
+    mbx_send(task_id, i);
+    mbx_recv(&sender_id, &msg);
+  }
+  bench_report("mbx_send + mbx_recv", start, bench_counter(timer_addr));
+
+  start = bench_counter(timer_addr);
+  for (i = 0; i < BENCH_LOOP_COUNT; i++) {
+    yield();
+  }
+  bench_report("yield", start, bench_counter(timer_addr));
+
+  io_write32(timer_addr + TIMER_BASE + CONFIG_OFFSET, 0);
+}
+#endif
+
 int main(int argc, char **argv, char **argp) {
   const uint32_t uart_addr = (uint32_t)(&__UART_begin[UART1_DEVICE_OFFSET]);
   const uint32_t timer_addr = (uint32_t)(&__TIMER_begin[TIMER_DEVICE_OFFSET]);
   os_status_t cr;
   os_mbx_msg_t msg = 0;
-  os_task_id_t tmp_id;
 
   (void)argc;
   (void)argv;
@@ -102,6 +174,10 @@ int main(int argc, char **argv, char **argp) {
 
   io_write32(uart_addr + UART_CTRL_OFFSET, UART_CTRL_TE);
 
+#if defined(CONFIG_APP_TIMER_SYSCALL_BENCH)
+  syscall_bench(timer_addr);
+#endif
+
   io_write32(timer_addr + SCALER_OFFSET, CLK_SCALLER);
   io_write32(timer_addr + SCALER_RELOAD_OFFSET, CLK_SCALLER);
 
@@ -114,47 +190,44 @@ int main(int argc, char **argv, char **argp) {
   printf("timer: init done\n");
 
   while (1) {
-    /* wait for a mbx from the interrupt task */
-    cr = wait(OS_MBX_MASK_ALL);
-
-    if (cr == OS_SUCCESS) {
+    uint32_t irq_lines;
+    uint32_t irq;
 
-      /* receive the mbx */
-      cr = mbx_recv(&tmp_id, &msg);
+    /* wait for the timer interrupt routed by the kernel */
+    cr = notify_wait(&irq_lines);
 
-      if (cr == OS_SUCCESS) {
-        printf("timer: mbx %d received from task %d\n", (int)msg, (int)tmp_id);
-
-        /* process mbx from the interrupt task */
-        if (tmp_id == OS_INTERRUPT_TASK_ID) {
-          uint32_t config_reg =
-              io_read32(timer_addr + TIMER_BASE + CONFIG_OFFSET);
+    if (cr == OS_SUCCESS) {
+      uint32_t config_reg = io_read32(timer_addr + TIMER_BASE + CONFIG_OFFSET);
 
-          /* check the timer interrupt has not been already processed */
-          if (config_reg & GPTIMER_INT_PENDING) {
-            /* mark the timer as being processed */
-            config_reg &= ~GPTIMER_INT_PENDING;
+      /* check the timer interrupt has not been already processed */
+      if (config_reg & GPTIMER_INT_PENDING) {
+        /* mark the timer as being processed */
+        config_reg &= ~GPTIMER_INT_PENDING;
 
-            io_write32(timer_addr + TIMER_BASE + CONFIG_OFFSET, config_reg);
+        io_write32(timer_addr + TIMER_BASE + CONFIG_OFFSET, config_reg);
 
-            /* For now send a MBX to all permitted task */
-            cr = mbx_send(OS_TASK_ID_ALL, msg);
+        /* For now send a MBX to all permitted task */
+        cr = mbx_send(OS_TASK_ID_ALL, msg);
 
-            if (cr == OS_SUCCESS) {
-              printf("timer: mbx %d sent to all tasks\n", (int)msg);
-            } else {
-              printf("timer: failed (cr = %d) to send mbx\n", (int)cr);
-            }
-          } else {
-            printf("timer: no int pending ???\n");
-          }
+        if (cr == OS_SUCCESS) {
+          printf("timer: mbx %d sent to all tasks\n", (int)msg);
         } else {
+          printf("timer: failed (cr = %d) to send mbx\n", (int)cr);
         }
+
+        msg++;
       } else {
-        printf("timer: failed (cr = %d) to recv mbx\n", (int)cr);
+        printf("timer: no int pending ???\n");
+      }
+
+      /* the interrupt lines are masked until we acknowledge them */
+      for (irq = 0; irq < OS_IRQ_MAX; irq++) {
+        if (irq_lines & (1U << irq)) {
+          irq_ack(irq);
+        }
       }
     } else {
-      printf("timer: failed (cr = %d) to wait for mbx\n", (int)cr);
+      printf("timer: failed (cr = %d) to wait for interrupt\n", (int)cr);
     }
   }
 }
@@ -26,3 +26,13 @@
 #include <os_arch.h>
 
 uint8_t os_arch_interrupt_is_pending(void) { return 0; }
+
+void os_arch_interrupt_init(void) {}
+
+void os_arch_interrupt_take(uint32_t *irq_lines) { *irq_lines = 0; }
+
+void os_arch_interrupt_unmask(uint32_t irq) { (void)irq; }
+
+void os_arch_interrupt_idle_enter(void) {}
+
+void os_arch_interrupt_idle_exit(void) {}
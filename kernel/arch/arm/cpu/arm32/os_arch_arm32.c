@@ -25,4 +25,9 @@
 /* function prototypes for this file */
 #include <os_arch.h>
 
-void os_arch_idle(void) { asm volatile("dsb; wfi"); }
+void os_arch_idle(void) {
+  os_arch_interrupt_idle_enter();
+  /* wfi wakes up on a pending interrupt even if it is masked */
+  asm volatile("dsb; wfi");
+  os_arch_interrupt_idle_exit();
+}
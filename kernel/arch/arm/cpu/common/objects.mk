@@ -24,4 +24,5 @@
 cpu-common-objs-y += os_arch_arm_entry.o
 cpu-common-objs-y += os_arch_arm_syscalls.o
 cpu-common-objs-y += os_arch_arm_context.o
+cpu-common-objs-$(CONFIG_FPU) += os_arch_arm_fpu.o
 
@@ -32,6 +32,11 @@
 
 #include <os_arch.h>
 
+#if defined(CONFIG_FPU)
+/* for os_arch_fpu_xxx() */
+#include <os_arch_fpu.h>
+#endif
+
 /**
  *
  */
@@ -39,6 +44,10 @@ void os_arch_context_create(os_task_id_t task_id) {
   (void)task_id;
 
   syslog("%s(task_id = %d)\n", __func__, (int)task_id);
+
+#if defined(CONFIG_FPU)
+  os_arch_fpu_release(task_id);
+#endif
 }
 
 /**
@@ -49,6 +58,10 @@ void os_arch_context_switch(os_task_id_t prev_id, os_task_id_t next_id) {
   (void)next_id;
   syslog("%s(prev_id = %d, next_id = %d)\n", __func__, (int)prev_id,
          (int)next_id);
+
+#if defined(CONFIG_FPU)
+  os_arch_fpu_switch(next_id);
+#endif
 }
 
 void os_arch_context_set(os_task_id_t task_id) {
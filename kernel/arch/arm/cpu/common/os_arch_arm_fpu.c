@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief lazy VFP context switch
+ */
+
+/* for syslog() */
+#include <syslog.h>
+
+/* for memset() */
+#include <string.h>
+
+/* function prototypes for this file */
+#include <os_arch_fpu.h>
+
+#define CPACR_CP10_CP11_FULL (0xf << 20) /**< cp10/cp11 full access */
+#define FPEXC_EN (1 << 30)               /**< VFP enable */
+
+/**
+ * VFP registers of a task (d0 - d15 and fpscr).
+ */
+typedef struct {
+  uint64_t d[16];
+  uint32_t fpscr;
+} __attribute__((aligned(8))) os_arch_fpu_ctx_t;
+
+/* A task starts with all its VFP registers cleared */
+static os_arch_fpu_ctx_t os_arch_fpu_ctx[CONFIG_MAX_TASK_COUNT];
+
+/* The task whose registers are in the VFP */
+static os_task_id_t os_arch_fpu_owner;
+
+static void os_arch_fpu_enable(int enable) {
+  uint32_t fpexc = enable ? FPEXC_EN : 0;
+
+  asm volatile(".fpu vfp\n\t"
+               "vmsr fpexc, %0\n\t"
+               : /* no output */
+               : "r"(fpexc)
+               : "memory");
+}
+
+static void os_arch_fpu_save(os_arch_fpu_ctx_t *ctx) {
+  uint32_t fpscr;
+
+  asm volatile(".fpu vfp\n\t"
+               "vstmia %1, {d0-d15}\n\t"
+               "vmrs %0, fpscr\n\t"
+               : "=r"(fpscr)
+               : "r"(ctx->d)
+               : "memory");
+
+  ctx->fpscr = fpscr;
+}
+
+static void os_arch_fpu_restore(const os_arch_fpu_ctx_t *ctx) {
+  asm volatile(".fpu vfp\n\t"
+               "vldmia %0, {d0-d15}\n\t"
+               "vmsr fpscr, %1\n\t"
+               : /* no output */
+               : "r"(ctx->d), "r"(ctx->fpscr)
+               : "memory");
+}
+
+/**
+ * Grant access to the VFP coprocessors but keep it disabled until a task
+ * needs it.
+ */
+void os_arch_fpu_init(void) {
+  uint32_t cpacr;
+
+  asm volatile("mrc p15, 0, %0, c1, c0, 2" : "=r"(cpacr));
+  cpacr |= CPACR_CP10_CP11_FULL;
+  asm volatile("mcr p15, 0, %0, c1, c0, 2\n\t"
+               "isb\n\t"
+               : /* no output */
+               : "r"(cpacr)
+               : "memory");
+
+  os_arch_fpu_owner = OS_TASK_ID_NONE;
+  os_arch_fpu_enable(0);
+}
+
+/**
+ * Only the owner of the VFP gets it enabled when it runs. Any other task
+ * traps (undefined instruction) on its first VFP instruction.
+ */
+void os_arch_fpu_switch(os_task_id_t task_id) {
+  os_arch_fpu_enable(task_id == os_arch_fpu_owner);
+}
+
+/**
+ * Give the VFP to task_id. The registers of the previous owner are saved
+ * only now.
+ */
+void os_arch_fpu_take(os_task_id_t task_id) {
+  os_arch_fpu_enable(1);
+
+  if (task_id != os_arch_fpu_owner) {
+    syslog("%s( task_id = %d, owner = %d )\n", __func__, (int)task_id,
+           (int)os_arch_fpu_owner);
+
+    if (os_arch_fpu_owner != OS_TASK_ID_NONE) {
+      os_arch_fpu_save(&os_arch_fpu_ctx[os_arch_fpu_owner]);
+    }
+
+    os_arch_fpu_restore(&os_arch_fpu_ctx[task_id]);
+
+    os_arch_fpu_owner = task_id;
+  }
+}
+
+/**
+ * Forget the VFP registers of a task which is (re)started.
+ */
+void os_arch_fpu_release(os_task_id_t task_id) {
+  if (task_id == os_arch_fpu_owner) {
+    os_arch_fpu_owner = OS_TASK_ID_NONE;
+    os_arch_fpu_enable(0);
+  }
+
+  memset(&os_arch_fpu_ctx[task_id], 0, sizeof(os_arch_fpu_ctx[task_id]));
+}
+
+/**
+ * Check if the VFP is enabled for the running task.
+ */
+int os_arch_fpu_is_enabled(void) {
+  uint32_t fpexc;
+
+  asm volatile(".fpu vfp\n\t"
+               "vmrs %0, fpexc\n\t"
+               : "=r"(fpexc));
+
+  return (fpexc & FPEXC_EN) != 0;
+}
@@ -26,7 +26,23 @@
 /* for syslog() */
 #include <syslog.h>
 
-void os_arch_undefined_instruction() {}
+#if defined(CONFIG_FPU)
+/* for os_arch_fpu_xxx() */
+#include <os_arch_fpu.h>
+#endif
+
+/**
+ * Undefined instruction handler.
+ * A VFP instruction of a task which does not own the VFP lands here. Give
+ * it the VFP and execute the instruction again.
+ */
+void os_arch_undefined_instruction() {
+#if defined(CONFIG_FPU)
+  if (!os_arch_fpu_is_enabled()) {
+    os_arch_fpu_take(os_sched_get_current_task_id());
+  }
+#endif
+}
 
 void os_arch_software_interrupt() {}
 
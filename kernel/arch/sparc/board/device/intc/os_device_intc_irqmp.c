@@ -31,9 +31,94 @@
 /* for IRQMP_XXX macros */
 #include "os_device_intc_irqmp.h"
 
+/* Interrupt lines owned by a task (routed by the kernel) */
+static uint32_t os_arch_irq_owned;
+
+/**
+ * Only the lines owned by a task are unmasked. The other lines are left
+ * to the interrupt task which polls the pending register.
+ */
+void os_arch_interrupt_init(void) {
+  uint32_t irq;
+
+  os_arch_irq_owned = 0;
+
+  for (irq = 0; irq < OS_IRQ_MAX; irq++) {
+    if (os_irq_owner[irq] != OS_TASK_ID_NONE) {
+      os_arch_irq_owned |= 1U << irq;
+    }
+  }
+
+  os_arch_irq_owned &= IRQMP_IRQ_MASK;
+
+  os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET,
+                     os_arch_irq_owned);
+}
+
+/**
+ * Check if an interrupt not owned by a task is pending.
+ */
 uint8_t os_arch_interrupt_is_pending(void) {
   uint32_t pending_irq =
       os_arch_io_read32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_PENDING_OFFSET);
 
-  return (pending_irq & IRQMP_IRQ_MASK) ? 1 : 0;
+  return (pending_irq & IRQMP_IRQ_MASK & ~os_arch_irq_owned) ? 1 : 0;
+}
+
+/**
+ * Retrieve the pending lines owned by a task. They are masked until their
+ * owner acknowledges them and they are cleared.
+ */
+void os_arch_interrupt_take(uint32_t *irq_lines) {
+  uint32_t pending_irq =
+      os_arch_io_read32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_PENDING_OFFSET) &
+      os_arch_irq_owned;
+
+  if (pending_irq) {
+    uint32_t mask =
+        os_arch_io_read32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET);
+
+    os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET,
+                       mask & ~pending_irq);
+    os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_CLEAR_OFFSET,
+                       pending_irq);
+  }
+
+  *irq_lines = pending_irq;
+}
+
+/**
+ * Unmask an owned line (ownership is checked by the caller).
+ */
+void os_arch_interrupt_unmask(uint32_t irq) {
+  uint32_t mask =
+      os_arch_io_read32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET);
+
+  os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET,
+                     mask | ((1U << irq) & os_arch_irq_owned));
+}
+
+/* Mask register saved while the processor is idle */
+static uint32_t os_arch_irq_idle_mask;
+
+/**
+ * Let every line wake the processor up while it is idle. The lines left
+ * to the interrupt task are only unmasked for this time as nothing would
+ * acknowledge them at the processor level.
+ */
+void os_arch_interrupt_idle_enter(void) {
+  os_arch_irq_idle_mask =
+      os_arch_io_read32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET);
+
+  os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET,
+                     os_arch_irq_idle_mask |
+                         (IRQMP_IRQ_MASK & ~os_arch_irq_owned));
+}
+
+/**
+ * Restore the mask register saved by os_arch_interrupt_idle_enter().
+ */
+void os_arch_interrupt_idle_exit(void) {
+  os_arch_io_write32(CONFIG_GRLIB_IRQMP_ADDR + IRQMP_MASK_OFFSET,
+                     os_arch_irq_idle_mask);
 }
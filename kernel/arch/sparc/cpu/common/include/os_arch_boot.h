@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief
+ */
+
+#ifndef __OS_ARCH_BOOT_H__
+#define __OS_ARCH_BOOT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Boot steps timed by the boot profile.
+ */
+typedef enum {
+  OS_ARCH_BOOT_RESET,          /**< the profile timer is started */
+  OS_ARCH_BOOT_KERNEL_ENTRY,   /**< kernel .bss and .stack are cleared */
+  OS_ARCH_BOOT_MMU_ON,         /**< the MMU is enabled */
+  OS_ARCH_BOOT_TASKS_CREATED,  /**< all tasks are created and scheduled */
+  OS_ARCH_BOOT_FIRST_DISPATCH, /**< the first task is about to run */
+  OS_ARCH_BOOT_STEP_COUNT
+} os_arch_boot_step_t;
+
+void os_arch_boot_stamp(os_arch_boot_step_t step);
+
+void os_arch_boot_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__OS_ARCH_BOOT_H__ */
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief
+ */
+
+#ifndef __OS_ARCH_FPU_H__
+#define __OS_ARCH_FPU_H__
+
+/* for os_task_id_t */
+#include <os.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void os_arch_fpu_init(void);
+
+void os_arch_fpu_switch(os_task_id_t task_id);
+
+void os_arch_fpu_take(os_task_id_t task_id);
+
+void os_arch_fpu_release(os_task_id_t task_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__OS_ARCH_FPU_H__ */
@@ -25,4 +25,5 @@ cpu-common-objs-y += os_arch_sparc_entry.o
 cpu-common-objs-y += os_arch_sparc_regwin.o
 cpu-common-objs-y += os_arch_sparc_syscalls.o
 cpu-common-objs-y += os_arch_sparc_context.o
+cpu-common-objs-$(CONFIG_FPU) += os_arch_sparc_fpu.o
 
@@ -24,7 +24,7 @@
 /* for syslog() */
 #include <syslog.h>
 
-/* for memset() */
+/* for memcpy() and memset() */
 #include <string.h>
 
 /* for various register offset in stack */
@@ -38,19 +38,92 @@
 
 #include <os_arch.h>
 
+#if defined(CONFIG_FPU)
+/* for os_arch_fpu_release() */
+#include <os_arch_fpu.h>
+#endif
+
 typedef struct {
   os_virtual_address_t stack_pointer;
+#if defined(CONFIG_LAZY_TASK_ZEROING)
+  uint8_t load_pending; /**< memory to load before next run */
+#endif
 } os_arch_task_rw_t;
 
 static os_arch_task_rw_t os_arch_task_rw[CONFIG_MAX_TASK_COUNT];
 
 /**
- *
+ * Copy the pristine .data image of a task to the start of its bss segment.
+ * The linker puts the image in its rodata segment, the two first words of
+ * rodata give its offset and size. Return the size of the image.
  */
-void os_arch_context_create(os_task_id_t task_id) {
+static uint32_t os_arch_context_load_data(os_task_id_t task_id) {
+  const uint32_t *header =
+      (const uint32_t *)os_task_ro[task_id].rodata.virtual_address;
+  uint32_t offset;
+  uint32_t size;
+
+  if (!header) {
+    return 0;
+  }
+
+  offset = header[0];
+  size = header[1];
+
+  if (!size || (size > os_task_ro[task_id].bss.size) ||
+      (size > os_task_ro[task_id].rodata.size) ||
+      (offset > os_task_ro[task_id].rodata.size - size)) {
+    return 0;
+  }
+
+  memcpy((void *)os_task_ro[task_id].bss.virtual_address,
+         (const void *)(os_task_ro[task_id].rodata.virtual_address + offset),
+         size);
+
+  return size;
+}
+
+/**
+ * Load the .data of a task and, if clear is set, clear the rest of its
+ * bss segment and its stack (its space has to be active).
+ */
+static void os_arch_context_load(os_task_id_t task_id, uint8_t clear) {
+  uint32_t data_size = os_arch_context_load_data(task_id);
+
+  if (clear) {
+    memset((void *)os_task_ro[task_id].stack.virtual_address, 0,
+           os_task_ro[task_id].stack.size);
+    memset((void *)(os_task_ro[task_id].bss.virtual_address + data_size), 0,
+           os_task_ro[task_id].bss.size - data_size);
+  }
+}
+
+/**
+ * Build the initial frame of a task at the top of its stack.
+ */
+static void os_arch_context_frame(os_task_id_t task_id) {
   uint32_t *ctx = (uint32_t *)(os_task_ro[task_id].stack.virtual_address +
                                os_task_ro[task_id].stack.size - 0x40);
 
+  /* Only 1 register window needed */
+  *(ctx - RESTORE_CNT_OFFSET/4) = 1;
+  *(ctx - PC_OFFSET/4) = os_task_ro[task_id].text.virtual_address;
+  *(ctx - NPC_OFFSET/4) = os_task_ro[task_id].text.virtual_address + 4;
+  /* Start with clear condition codes and %y */
+  *(ctx - PSR_OFFSET/4) = 0;
+  *(ctx - Y_OFFSET/4) = 0;
+  *(ctx - I0_OFFSET/4) = (uint32_t)task_id;
+
+  os_arch_task_rw[task_id].stack_pointer = (uint32_t)ctx;
+}
+
+/**
+ *
+ */
+void os_arch_context_create(os_task_id_t task_id) {
+  /* No stack pointer yet: this is the boot time creation */
+  uint8_t first_create = (os_arch_task_rw[task_id].stack_pointer == 0);
+
   syslog("%s( task_id = %d )\n", __func__, (int)task_id);
 
   if (!os_task_ro[task_id].stack.size || !os_task_ro[task_id].bss.size ||
@@ -62,18 +135,25 @@ void os_arch_context_create(os_task_id_t task_id) {
     }
   }
 
-  memset((void *)os_task_ro[task_id].stack.virtual_address, 0,
-         os_task_ro[task_id].stack.size);
-  memset((void *)os_task_ro[task_id].bss.virtual_address, 0,
-         os_task_ro[task_id].bss.size);
+  if (first_create) {
+#if defined(CONFIG_LAZY_TASK_ZEROING)
+    /* Loaded by os_arch_context_restore() on first dispatch */
+    os_arch_task_rw[task_id].load_pending = 1;
+#elif defined(CONFIG_BOOT_RAM_ZEROED)
+    os_arch_context_load(task_id, 0);
+#else
+    os_arch_context_load(task_id, 1);
+#endif
+  } else {
+    /* A restarted task always gets a clean memory */
+    os_arch_context_load(task_id, 1);
+  }
 
-  /* Only 1 register window needed */
-  *(ctx - RESTORE_CNT_OFFSET/4) = 1;
-  *(ctx - PC_OFFSET/4) = os_task_ro[task_id].text.virtual_address;
-  *(ctx - NPC_OFFSET/4) = os_task_ro[task_id].text.virtual_address + 4;
-  *(ctx - I0_OFFSET/4) = (uint32_t)task_id;
+#if defined(CONFIG_FPU)
+  os_arch_fpu_release(task_id);
+#endif
 
-  os_arch_task_rw[task_id].stack_pointer = (uint32_t)ctx;
+  os_arch_context_frame(task_id);
 }
 
 /**
@@ -90,5 +170,15 @@ void os_arch_context_save(os_task_id_t task_id, uint32_t *stack_pointer)
  */
 uint32_t *os_arch_context_restore(os_task_id_t task_id) {
   syslog("%s( task_id = %d )\n", __func__, (int)task_id);
+
+#if defined(CONFIG_LAZY_TASK_ZEROING)
+  if (os_arch_task_rw[task_id].load_pending) {
+    os_arch_task_rw[task_id].load_pending = 0;
+    os_arch_context_load(task_id, 1);
+    /* the initial frame was cleared with the stack */
+    os_arch_context_frame(task_id);
+  }
+#endif
+
   return (uint32_t *)os_arch_task_rw[task_id].stack_pointer;
 }
@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2017 Jean-Christophe Dubois
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * @file
+ * @author Jean-Christophe Dubois (jcd@tribudubois.net)
+ * @brief lazy FPU context switch
+ */
+
+/* for syslog() */
+#include <syslog.h>
+
+/* for memset() */
+#include <string.h>
+
+/* function prototypes for this file */
+#include <os_arch_fpu.h>
+
+#define PSR_EF 0x00001000 /**< Enable Floating Point */
+
+/**
+ * FPU registers of a task (%f0 - %f31 and %fsr).
+ */
+typedef struct {
+  uint64_t f[16];
+  uint32_t fsr;
+} __attribute__((aligned(8))) os_arch_fpu_ctx_t;
+
+/* A task starts with all its FPU registers cleared */
+static os_arch_fpu_ctx_t os_arch_fpu_ctx[CONFIG_MAX_TASK_COUNT];
+
+/* The task whose registers are in the FPU */
+static os_task_id_t os_arch_fpu_owner;
+
+static void os_arch_fpu_enable(int enable) {
+  uint32_t psr;
+
+  asm volatile("rd %%psr, %0" : "=r"(psr));
+
+  if (enable) {
+    psr |= PSR_EF;
+  } else {
+    psr &= ~PSR_EF;
+  }
+
+  asm volatile("wr %0, %%psr\n\t"
+               "nop; nop; nop\n\t"
+               : /* no output */
+               : "r"(psr)
+               : "memory");
+}
+
+static void os_arch_fpu_save(os_arch_fpu_ctx_t *ctx) {
+  asm volatile("std %%f0, [%0 + 0x00]\n\t"
+               "std %%f2, [%0 + 0x08]\n\t"
+               "std %%f4, [%0 + 0x10]\n\t"
+               "std %%f6, [%0 + 0x18]\n\t"
+               "std %%f8, [%0 + 0x20]\n\t"
+               "std %%f10, [%0 + 0x28]\n\t"
+               "std %%f12, [%0 + 0x30]\n\t"
+               "std %%f14, [%0 + 0x38]\n\t"
+               "std %%f16, [%0 + 0x40]\n\t"
+               "std %%f18, [%0 + 0x48]\n\t"
+               "std %%f20, [%0 + 0x50]\n\t"
+               "std %%f22, [%0 + 0x58]\n\t"
+               "std %%f24, [%0 + 0x60]\n\t"
+               "std %%f26, [%0 + 0x68]\n\t"
+               "std %%f28, [%0 + 0x70]\n\t"
+               "std %%f30, [%0 + 0x78]\n\t"
+               "st %%fsr, [%0 + 0x80]\n\t"
+               : /* no output */
+               : "r"(ctx)
+               : "memory");
+}
+
+static void os_arch_fpu_restore(const os_arch_fpu_ctx_t *ctx) {
+  asm volatile("ldd [%0 + 0x00], %%f0\n\t"
+               "ldd [%0 + 0x08], %%f2\n\t"
+               "ldd [%0 + 0x10], %%f4\n\t"
+               "ldd [%0 + 0x18], %%f6\n\t"
+               "ldd [%0 + 0x20], %%f8\n\t"
+               "ldd [%0 + 0x28], %%f10\n\t"
+               "ldd [%0 + 0x30], %%f12\n\t"
+               "ldd [%0 + 0x38], %%f14\n\t"
+               "ldd [%0 + 0x40], %%f16\n\t"
+               "ldd [%0 + 0x48], %%f18\n\t"
+               "ldd [%0 + 0x50], %%f20\n\t"
+               "ldd [%0 + 0x58], %%f22\n\t"
+               "ldd [%0 + 0x60], %%f24\n\t"
+               "ldd [%0 + 0x68], %%f26\n\t"
+               "ldd [%0 + 0x70], %%f28\n\t"
+               "ldd [%0 + 0x78], %%f30\n\t"
+               "ld [%0 + 0x80], %%fsr\n\t"
+               : /* no output */
+               : "r"(ctx)
+               : "memory");
+}
+
+/**
+ * No task owns the FPU at boot and it stays disabled.
+ */
+void os_arch_fpu_init(void) {
+  os_arch_fpu_owner = OS_TASK_ID_NONE;
+  os_arch_fpu_enable(0);
+}
+
+/**
+ * Only the owner of the FPU gets it enabled when it runs. Any other task
+ * traps (fp_disabled) on its first FPU instruction.
+ */
+void os_arch_fpu_switch(os_task_id_t task_id) {
+  os_arch_fpu_enable(task_id == os_arch_fpu_owner);
+}
+
+/**
+ * Give the FPU to task_id. The registers of the previous owner are saved
+ * only now.
+ */
+void os_arch_fpu_take(os_task_id_t task_id) {
+  os_arch_fpu_enable(1);
+
+  if (task_id != os_arch_fpu_owner) {
+    syslog("%s( task_id = %d, owner = %d )\n", __func__, (int)task_id,
+           (int)os_arch_fpu_owner);
+
+    if (os_arch_fpu_owner != OS_TASK_ID_NONE) {
+      os_arch_fpu_save(&os_arch_fpu_ctx[os_arch_fpu_owner]);
+    }
+
+    os_arch_fpu_restore(&os_arch_fpu_ctx[task_id]);
+
+    os_arch_fpu_owner = task_id;
+  }
+}
+
+/**
+ * Forget the FPU registers of a task which is (re)started.
+ */
+void os_arch_fpu_release(os_task_id_t task_id) {
+  if (task_id == os_arch_fpu_owner) {
+    os_arch_fpu_owner = OS_TASK_ID_NONE;
+    os_arch_fpu_enable(0);
+  }
+
+  memset(&os_arch_fpu_ctx[task_id], 0, sizeof(os_arch_fpu_ctx[task_id]));
+}
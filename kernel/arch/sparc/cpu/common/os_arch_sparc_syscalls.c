@@ -32,43 +32,260 @@
 /* for os_arch_context_switch() */
 #include <os_arch_context.h>
 
+#if defined(CONFIG_FPU)
+/* for os_arch_fpu_xxx() */
+#include <os_arch_fpu.h>
+#endif
+
+#if defined(CONFIG_BOOT_PROFILE)
+/* for os_arch_boot_xxx() */
+#include <os_arch_boot.h>
+#endif
+
 #define SPARC_TRAP_SYSCALL_BASE 0x80
 
+/**
+ * Result to return to a blocked task when it is elected again.
+ */
+#define OS_ARCH_PENDING_NONE 0
+#define OS_ARCH_PENDING_MBX 1    /* mbx_wait_recv(), mbx_call()... */
+#define OS_ARCH_PENDING_NOTIFY 2 /* notify_wait() */
+#define OS_ARCH_PENDING_SEND 3   /* mbx_send_wait() */
+
+static uint8_t os_arch_pending[CONFIG_MAX_TASK_COUNT];
+
+/* Switch started by os_arch_sched_switch() */
+static os_task_id_t os_arch_switch_from;
+static os_task_id_t os_arch_switch_to;
+
+/* The task we switch from exited and is recreated */
+static uint8_t os_arch_switch_exit;
+
+/**
+ * Retrieve a mbx for the current task and return it in its context.
+ * The status is returned in %o0, the sender in %o1 and the message in
+ * %o2 (high word) and %o3 (low word).
+ */
+static void os_arch_mbx_receive_to_ctx(uint32_t *ctx) {
+  os_status_t status;
+  os_mbx_entry_t entry;
+
+  entry.sender_id = OS_TASK_ID_NONE;
+  entry.msg = 0;
+
+  os_mbx_receive(&status, &entry);
+
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - I1_OFFSET/4) = (uint32_t)entry.sender_id;
+  *(ctx - I2_OFFSET/4) = OS_MBX_MSG_HI(entry.msg);
+  *(ctx - I3_OFFSET/4) = OS_MBX_MSG_LO(entry.msg);
+}
+
+/**
+ * Retrieve the notifications of the current task and return them in its
+ * context. The status is returned in %o0 and the bits in %o1.
+ */
+static void os_arch_notify_take_to_ctx(uint32_t *ctx) {
+  uint32_t bits;
+
+  os_mbx_notify_take(&bits);
+
+  *(ctx - I0_OFFSET/4) = OS_SUCCESS;
+  *(ctx - I1_OFFSET/4) = bits;
+}
+
+/**
+ * Return the final status of a blocked mbx_send_wait() in %o0.
+ */
+static void os_arch_send_wait_status_to_ctx(uint32_t *ctx) {
+  os_status_t status;
+
+  os_mbx_send_wait_status(&status);
+
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+}
+
+/**
+ * Check that a buffer is fully inside a section of the current task.
+ */
+static int os_arch_section_contains(const os_task_section_t *section,
+                                    uint32_t addr, uint32_t size) {
+  return (addr >= section->virtual_address) && (size <= section->size) &&
+         ((addr - section->virtual_address) <= (section->size - size));
+}
+
+/**
+ * Check that a user buffer passed to a system call is correctly aligned and
+ * is inside the writable memory (.bss or stack) of the current task.
+ */
+static int os_arch_user_buffer_ok(uint32_t addr, uint32_t size,
+                                  uint32_t align) {
+  const os_task_ro_t *task = &os_task_ro[os_sched_get_current_task_id()];
+
+  if (addr & (align - 1)) {
+    return 0;
+  }
+
+  return os_arch_section_contains(&task->bss, addr, size) ||
+         os_arch_section_contains(&task->stack, addr, size);
+}
+
+/**
+ * Get the mbx mask passed in a register by the current task.
+ * A single word mask is the register value. A wider mask is passed by
+ * address and is read from the current task memory. An invalid address
+ * gives OS_ERROR_PARAM.
+ */
+static os_status_t os_arch_get_mbx_mask(uint32_t reg,
+                                        os_mbx_mask_t *mbx_mask) {
+#if OS_MBX_MASK_WORD_CNT == 1
+  *mbx_mask = OS_MBX_MASK_NONE;
+  mbx_mask->word[0] = reg;
+#else
+  const os_task_ro_t *task = &os_task_ro[os_sched_get_current_task_id()];
+
+  if (!os_arch_user_buffer_ok(reg, sizeof(*mbx_mask), sizeof(uint32_t)) &&
+      !((reg & (sizeof(uint32_t) - 1)) == 0 &&
+        os_arch_section_contains(&task->text, reg, sizeof(*mbx_mask)))) {
+    return OS_ERROR_PARAM;
+  }
+
+  *mbx_mask = *(const os_mbx_mask_t *)reg;
+#endif
+
+  return OS_SUCCESS;
+}
+
+/**
+ * Start the switch from the current task to the elected one (if different).
+ * Return NULL in this case so that the service handler flushes the register
+ * windows of the current task and calls os_arch_sched_switch_end().
+ */
+static uint32_t *os_arch_sched_switch(os_task_id_t current_task_id,
+                                      os_task_id_t new_task_id,
+                                      uint32_t *ctx) {
+  if (current_task_id != new_task_id) {
+    os_arch_context_save(current_task_id, ctx);
+
+    /*
+     * The register windows of the current task are still in place. They
+     * are flushed to its stack before os_arch_sched_switch_end() is
+     * called to switch to the new task.
+     */
+    os_arch_switch_from = current_task_id;
+    os_arch_switch_to = new_task_id;
+    ctx = NULL;
+  }
+
+  return ctx;
+}
+
+/**
+ * Complete the switch started by os_arch_sched_switch() once the windows
+ * of the previous task have been flushed. Return the stack pointer of the
+ * elected task.
+ * If the elected task was blocked waiting for a mbx or a notification, it
+ * is retrieved now that its address space is active.
+ */
+uint32_t *os_arch_sched_switch_end(void) {
+  os_task_id_t new_task_id = os_arch_switch_to;
+  uint32_t *ctx;
+
+  if (os_arch_switch_exit) {
+    /* Its windows are flushed, its stack can be rebuilt */
+    os_arch_switch_exit = 0;
+    os_arch_context_create(os_arch_switch_from);
+  }
+
+  os_arch_space_switch(os_arch_switch_from, new_task_id);
+  ctx = os_arch_context_restore(new_task_id);
+
+#if defined(CONFIG_FPU)
+  os_arch_fpu_switch(new_task_id);
+#endif
+
+  switch (os_arch_pending[new_task_id]) {
+  case OS_ARCH_PENDING_MBX:
+    os_arch_mbx_receive_to_ctx(ctx);
+    break;
+  case OS_ARCH_PENDING_NOTIFY:
+    os_arch_notify_take_to_ctx(ctx);
+    break;
+  case OS_ARCH_PENDING_SEND:
+    os_arch_send_wait_status_to_ctx(ctx);
+    break;
+  default:
+    break;
+  }
+
+  os_arch_pending[new_task_id] = OS_ARCH_PENDING_NONE;
+
+  return ctx;
+}
+
 /**
  * Syscalls handlers.
  */
 
 uint32_t *os_arch_init(void) {
   os_task_id_t task_id;
+  uint32_t *ctx;
+#if defined(CONFIG_BOOT_PROFILE)
+  os_arch_boot_stamp(OS_ARCH_BOOT_KERNEL_ENTRY);
+#endif
+#if defined(CONFIG_FPU)
+  os_arch_fpu_init();
+#endif
   os_init(&task_id);
-  return os_arch_context_restore(task_id);
+#if defined(CONFIG_BOOT_PROFILE)
+  os_arch_boot_stamp(OS_ARCH_BOOT_TASKS_CREATED);
+#endif
+  ctx = os_arch_context_restore(task_id);
+#if defined(CONFIG_BOOT_PROFILE)
+  os_arch_boot_stamp(OS_ARCH_BOOT_FIRST_DISPATCH);
+  os_arch_boot_report();
+#endif
+  return ctx;
 }
 
 /**
  * Wait function handler.
  */
 uint32_t *os_arch_sched_wait(uint32_t *ctx) {
+  os_status_t status;
   os_task_id_t current_task_id;
   os_task_id_t new_task_id;
-  os_mbx_mask_t mbx_mask = (os_mbx_mask_t)(*(ctx - I0_OFFSET/4));
+  os_mbx_mask_t mbx_mask;
 
   syslog("%s: \n", __func__);
 
-  current_task_id = os_sched_get_current_task_id();
-  os_sched_wait(&new_task_id, mbx_mask);
+  status = os_arch_get_mbx_mask(*(ctx - I0_OFFSET/4), &mbx_mask);
 
-  *(ctx - I0_OFFSET/4) = OS_SUCCESS;
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
   *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
   *(ctx - NPC_OFFSET/4) += 4;
 
-  if (current_task_id != new_task_id) {
-    os_arch_context_save(current_task_id, ctx);
-    os_arch_space_switch(current_task_id, new_task_id);
-    ctx = os_arch_context_restore(new_task_id);
+  if (status != OS_SUCCESS) {
+    return ctx;
   }
 
+  current_task_id = os_sched_get_current_task_id();
+  os_sched_wait(&new_task_id, mbx_mask);
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+#if defined(CONFIG_FPU)
+/**
+ * fp_disabled trap handler.
+ * Give the FPU to the current task and execute its FPU instruction again.
+ */
+uint32_t *os_arch_fp_disabled(uint32_t *ctx) {
+  os_arch_fpu_take(os_sched_get_current_task_id());
+
   return ctx;
 }
+#endif
 
 /**
  * Yield function handler.
@@ -81,38 +298,138 @@ uint32_t *os_arch_sched_yield(uint32_t *ctx) {
   syslog("%s: \n", __func__);
 
   current_task_id = os_sched_get_current_task_id();
-  os_sched_yield(&new_task_id);
+
+  /* Nothing to do if the current task would be elected again */
+  if (os_sched_yield_is_noop() && !os_arch_interrupt_is_pending()) {
+    new_task_id = current_task_id;
+  } else {
+    os_sched_yield(&new_task_id);
+  }
 
   *(ctx - I0_OFFSET/4) = OS_SUCCESS;
   *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
   *(ctx - NPC_OFFSET/4) += 4;
 
-  if (current_task_id != new_task_id) {
-    os_arch_context_save(current_task_id, ctx);
-    os_arch_space_switch(current_task_id, new_task_id);
-    ctx = os_arch_context_restore(new_task_id);
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+/**
+ * Mailbox receive function handler.
+ * We call the os_mbx_receive function and return the mbx in the registers.
+ */
+uint32_t *os_arch_mbx_receive(uint32_t *ctx) {
+  syslog("%s: \n", __func__);
+
+  os_arch_mbx_receive_to_ctx(ctx);
+
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  return ctx;
+}
+
+/**
+ * Mailbox send function handler.
+ * We get the destination in %o0 and the message in %o1 (high word) and %o2
+ * (low word) and we call the os_mbx_send function.
+ */
+uint32_t *os_arch_mbx_send(uint32_t *ctx) {
+  os_status_t status;
+  os_task_id_t dest_id = (os_task_id_t)(*(ctx - I0_OFFSET/4));
+  os_mbx_msg_t msg = OS_MBX_MSG(*(ctx - I1_OFFSET/4), *(ctx - I2_OFFSET/4));
+
+  syslog("%s: \n", __func__);
+
+  os_mbx_send(&status, dest_id, msg);
+
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  return ctx;
+}
+
+/**
+ * Mailbox query function handler.
+ * Fill the os_mbx_query_t buffer (%o0) with the state of the task FIFO.
+ */
+uint32_t *os_arch_mbx_query(uint32_t *ctx) {
+  os_status_t status = OS_SUCCESS;
+  uint32_t addr = *(ctx - I0_OFFSET/4);
+
+  syslog("%s: \n", __func__);
+
+  if (!os_arch_user_buffer_ok(addr, sizeof(os_mbx_query_t),
+                              __alignof__(os_mbx_query_t))) {
+    status = OS_ERROR_PARAM;
+  } else {
+    os_mbx_query((os_mbx_query_t *)addr);
   }
 
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
   return ctx;
 }
 
 /**
- * Mailbox receive function handler.
- * We get the arguments from the stack and we call the os_mbx_receive function.
+ * Mailbox batch receive function handler.
+ * We get the buffer in %o0 and its size (in mbx) in %o1. The status is
+ * returned in %o0 and the number of mbx received in %o1.
  */
-uint32_t *os_arch_mbx_receive(uint32_t *ctx) {
+uint32_t *os_arch_mbx_receive_batch(uint32_t *ctx) {
   os_status_t status;
-  os_mbx_entry_t *entry =
-      (os_mbx_entry_t *)os_task_ro[os_sched_get_current_task_id()]
-          .bss.virtual_address;
+  uint32_t received = 0;
+  uint32_t addr = *(ctx - I0_OFFSET/4);
+  uint32_t count = *(ctx - I1_OFFSET/4);
 
   syslog("%s: \n", __func__);
 
-  /* cleanup the MBX before receiving it */
-  entry->sender_id = OS_TASK_ID_NONE;
-  entry->msg = 0;
+  if ((count > CONFIG_MBX_BATCH_COUNT) ||
+      !os_arch_user_buffer_ok(addr, count * sizeof(os_mbx_entry_t),
+                              __alignof__(os_mbx_entry_t))) {
+    status = OS_ERROR_PARAM;
+  } else {
+    os_mbx_receive_batch(&status, &received, count, (os_mbx_entry_t *)addr);
+  }
 
-  os_mbx_receive(&status, entry);
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - I1_OFFSET/4) = received;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  return ctx;
+}
+
+/**
+ * Mailbox batch send function handler.
+ * We get the mbx buffer in %o0, its size (in mbx) in %o1 and the status
+ * buffer in %o2. The global status is returned in %o0.
+ */
+uint32_t *os_arch_mbx_send_batch(uint32_t *ctx) {
+  os_status_t status;
+  uint32_t addr = *(ctx - I0_OFFSET/4);
+  uint32_t count = *(ctx - I1_OFFSET/4);
+  uint32_t status_addr = *(ctx - I2_OFFSET/4);
+  uint32_t size = count * sizeof(os_mbx_send_entry_t);
+  const os_task_ro_t *task = &os_task_ro[os_sched_get_current_task_id()];
+
+  syslog("%s: \n", __func__);
+
+  if ((count > CONFIG_MBX_BATCH_COUNT) ||
+      !os_arch_user_buffer_ok(status_addr, count * sizeof(os_status_t),
+                              __alignof__(os_status_t))) {
+    status = OS_ERROR_PARAM;
+  } else if ((addr & (__alignof__(os_mbx_send_entry_t) - 1)) ||
+             !(os_arch_user_buffer_ok(addr, size, 1) ||
+               os_arch_section_contains(&task->text, addr, size))) {
+    /* The mbx can also be in a read only table of the task */
+    status = OS_ERROR_PARAM;
+  } else {
+    os_mbx_send_batch(&status, count, (const os_mbx_send_entry_t *)addr,
+                      (os_status_t *)status_addr);
+  }
 
   *(ctx - I0_OFFSET/4) = (uint32_t)status;
   *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
@@ -122,22 +439,186 @@ uint32_t *os_arch_mbx_receive(uint32_t *ctx) {
 }
 
 /**
- * Mailbox send function handler.
- * We get the arguments from the stack and we call the os_mbx_send function.
+ * Mailbox wait and receive function handler.
+ * Wait for a mbx from one of the tasks in the mask and retrieve it in the
+ * same trap. If the mbx is not there yet, the task is blocked and the mbx
+ * is retrieved when the task is elected again.
  */
-uint32_t *os_arch_mbx_send(uint32_t *ctx) {
+uint32_t *os_arch_mbx_wait_recv(uint32_t *ctx) {
+  os_status_t status;
+  os_task_id_t current_task_id;
+  os_task_id_t new_task_id;
+  os_mbx_mask_t mbx_mask;
+
+  syslog("%s: \n", __func__);
+
+  status = os_arch_get_mbx_mask(*(ctx - I0_OFFSET/4), &mbx_mask);
+
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  if (status != OS_SUCCESS) {
+    *(ctx - I0_OFFSET/4) = (uint32_t)status;
+    return ctx;
+  }
+
+  current_task_id = os_sched_get_current_task_id();
+  os_sched_wait(&new_task_id, mbx_mask);
+
+  if (current_task_id == new_task_id) {
+    /* The mbx is already there (or we could not wait), get it now */
+    os_arch_mbx_receive_to_ctx(ctx);
+  } else {
+    os_arch_pending[current_task_id] = OS_ARCH_PENDING_MBX;
+  }
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+/**
+ * Mailbox blocking send function handler.
+ * Send a mbx to the destination (%o0). If the destination FIFO is full the
+ * task is blocked until the mbx can be queued (or the destination exits).
+ * The final status is then returned when the task is elected again.
+ */
+uint32_t *os_arch_mbx_send_wait(uint32_t *ctx) {
+  os_status_t status;
+  os_task_id_t current_task_id;
+  os_task_id_t new_task_id;
+  os_task_id_t dest_id = (os_task_id_t)(*(ctx - I0_OFFSET/4));
+  os_mbx_msg_t msg = OS_MBX_MSG(*(ctx - I1_OFFSET/4), *(ctx - I2_OFFSET/4));
+
+  syslog("%s: \n", __func__);
+
+  current_task_id = os_sched_get_current_task_id();
+  os_mbx_send_wait(&status, &new_task_id, dest_id, msg);
+
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  if (current_task_id != new_task_id) {
+    /* Blocked: the final status is known when the task is woken up */
+    os_arch_pending[current_task_id] = OS_ARCH_PENDING_SEND;
+  }
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+/**
+ * Interrupt ack function handler.
+ * Unmask the interrupt line (%o0) owned by the current task.
+ */
+uint32_t *os_arch_irq_ack(uint32_t *ctx) {
+  os_status_t status;
+  uint32_t irq = *(ctx - I0_OFFSET/4);
+
+  os_mbx_irq_ack(&status, irq);
+
+  *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  return ctx;
+}
+
+/**
+ * Interrupt trap handler (traps 0x11 to 0x1f).
+ * The pending lines owned by a task are masked and notified to their owner.
+ * Moth is cooperative, so the interrupted task is resumed and the owner
+ * runs at the next scheduling point. The interrupted instruction is not
+ * skipped.
+ */
+uint32_t *os_arch_interrupt(uint32_t *ctx) {
+  os_mbx_irq_route();
+
+  return ctx;
+}
+
+/**
+ * Mailbox call function handler.
+ * Send a mbx to the destination (%o0) and wait for its answer. The answer
+ * is returned in the registers as for mbx_wait_recv().
+ */
+uint32_t *os_arch_mbx_call(uint32_t *ctx) {
   os_status_t status;
-  os_mbx_entry_t *entry =
-      (os_mbx_entry_t *)os_task_ro[os_sched_get_current_task_id()]
-          .bss.virtual_address;
+  os_task_id_t current_task_id;
+  os_task_id_t new_task_id;
+  os_task_id_t dest_id = (os_task_id_t)(*(ctx - I0_OFFSET/4));
+  os_mbx_msg_t msg = OS_MBX_MSG(*(ctx - I1_OFFSET/4), *(ctx - I2_OFFSET/4));
 
   syslog("%s: \n", __func__);
 
-  os_mbx_send(&status, entry->sender_id, entry->msg);
+  current_task_id = os_sched_get_current_task_id();
+  os_mbx_call(&status, &new_task_id, dest_id, msg);
 
-  /* cleanup the MBX after sending it */
-  entry->sender_id = OS_TASK_ID_NONE;
-  entry->msg = 0;
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  if (status != OS_SUCCESS) {
+    *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  } else if (current_task_id == new_task_id) {
+    os_arch_mbx_receive_to_ctx(ctx);
+  } else {
+    os_arch_pending[current_task_id] = OS_ARCH_PENDING_MBX;
+  }
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+/**
+ * Mailbox reply and wait function handler.
+ * Send an answer to the destination (%o0) if any and wait for the next mbx
+ * from the tasks in the mask (%o3). The mbx is returned in the registers
+ * as for mbx_wait_recv().
+ */
+uint32_t *os_arch_mbx_reply_wait(uint32_t *ctx) {
+  os_status_t status;
+  os_task_id_t current_task_id;
+  os_task_id_t new_task_id;
+  os_task_id_t dest_id = (os_task_id_t)(*(ctx - I0_OFFSET/4));
+  os_mbx_msg_t msg = OS_MBX_MSG(*(ctx - I1_OFFSET/4), *(ctx - I2_OFFSET/4));
+  os_mbx_mask_t mbx_mask;
+
+  syslog("%s: \n", __func__);
+
+  status = os_arch_get_mbx_mask(*(ctx - I3_OFFSET/4), &mbx_mask);
+
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  /* A bad mask fails the call before the answer is sent */
+  if (status != OS_SUCCESS) {
+    *(ctx - I0_OFFSET/4) = (uint32_t)status;
+    return ctx;
+  }
+
+  current_task_id = os_sched_get_current_task_id();
+  os_mbx_reply_wait(&status, &new_task_id, dest_id, msg, mbx_mask);
+
+  if (status != OS_SUCCESS) {
+    *(ctx - I0_OFFSET/4) = (uint32_t)status;
+  } else if (current_task_id == new_task_id) {
+    os_arch_mbx_receive_to_ctx(ctx);
+  } else {
+    os_arch_pending[current_task_id] = OS_ARCH_PENDING_MBX;
+  }
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
+/**
+ * Notify function handler.
+ * OR the bits in %o1 into the notification word of the task in %o0.
+ */
+uint32_t *os_arch_notify(uint32_t *ctx) {
+  os_status_t status;
+  os_task_id_t dest_id = (os_task_id_t)(*(ctx - I0_OFFSET/4));
+  uint32_t bits = *(ctx - I1_OFFSET/4);
+
+  syslog("%s: \n", __func__);
+
+  os_mbx_notify(&status, dest_id, bits);
 
   *(ctx - I0_OFFSET/4) = (uint32_t)status;
   *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
@@ -146,6 +627,31 @@ uint32_t *os_arch_mbx_send(uint32_t *ctx) {
   return ctx;
 }
 
+/**
+ * Notify wait function handler.
+ * Wait for a notification and return (and clear) the notification word.
+ */
+uint32_t *os_arch_notify_wait(uint32_t *ctx) {
+  os_task_id_t current_task_id;
+  os_task_id_t new_task_id;
+
+  syslog("%s: \n", __func__);
+
+  current_task_id = os_sched_get_current_task_id();
+  os_sched_wait_notify(&new_task_id);
+
+  *(ctx - PC_OFFSET/4) += 4; // skip "ta" instruction
+  *(ctx - NPC_OFFSET/4) += 4;
+
+  if (current_task_id == new_task_id) {
+    os_arch_notify_take_to_ctx(ctx);
+  } else {
+    os_arch_pending[current_task_id] = OS_ARCH_PENDING_NOTIFY;
+  }
+
+  return os_arch_sched_switch(current_task_id, new_task_id, ctx);
+}
+
 /**
  * Exit function handler.
  * Handle the case when a task ends.
@@ -159,15 +665,19 @@ uint32_t *os_arch_sched_exit(uint32_t *ctx) {
   current_task_id = os_sched_get_current_task_id();
   os_sched_exit(&new_task_id);
 
-  os_arch_context_create(current_task_id);
+  (void)ctx;
 
-  if (current_task_id != new_task_id) {
-    os_arch_context_save(current_task_id, ctx);
-    os_arch_space_switch(current_task_id, new_task_id);
-    ctx = os_arch_context_restore(new_task_id);
-  } 
+  /*
+   * The task still runs on its stack and its register windows are only
+   * flushed by the switch path. It is recreated in
+   * os_arch_sched_switch_end(), so take this path even if it is elected
+   * again.
+   */
+  os_arch_switch_exit = 1;
+  os_arch_switch_from = current_task_id;
+  os_arch_switch_to = new_task_id;
 
-  return ctx;
+  return NULL;
 }
 
 /**
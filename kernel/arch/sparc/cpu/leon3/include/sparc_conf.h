@@ -26,4 +26,15 @@
 
 #define WINDOWS_NBR 8 /**< Number of register windows */
 
+#if defined(CONFIG_BOOT_TIMER)
+/* GPTIMER timer 2 counts down from 0xffffffff since reset */
+#define BOOT_TIMER_SCALER_OFFSET 0x00
+#define BOOT_TIMER_SCALER_RELOAD_OFFSET 0x04
+#define BOOT_TIMER_COUNTER_OFFSET 0x20
+#define BOOT_TIMER_RELOAD_OFFSET 0x24
+#define BOOT_TIMER_CTRL_OFFSET 0x28
+#define BOOT_TIMER_START 0x07 /**< enable, restart and load */
+#define BOOT_TIMER_SCALER 7   /**< the timer ticks every 8 clock cycles */
+#endif
+
 #endif /* ! __MOTH_SPARC_LEON3_CONF_H_ */
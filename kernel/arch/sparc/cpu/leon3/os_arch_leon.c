@@ -25,7 +25,187 @@
 /* function prototypes for this file */
 #include <os_arch.h>
 
+/* for syslog() */
+#include <syslog.h>
+
+#if defined(CONFIG_BOOT_TIMER)
+/* for os_arch_io_read32() */
+#include "os_arch_ioports.h"
+
+/* for BOOT_TIMER_XXX macros */
+#include "sparc_conf.h"
+#endif
+
+#if defined(CONFIG_BOOT_PROFILE)
+/* function prototypes for the boot profile */
+#include <os_arch_boot.h>
+#endif
+
+#define PSR_PIL_MASK 0x00000f00 /**< Proc Interrupt Level */
+
+#if defined(CONFIG_BOOT_TIMER)
+/**
+ * Read the boot timer. It counts down once every BOOT_TIMER_SCALER + 1
+ * clock cycles since reset.
+ */
+static inline uint32_t os_arch_boot_timer_read(void) {
+  return os_arch_io_read32(CONFIG_BOOT_TIMER_ADDR + BOOT_TIMER_COUNTER_OFFSET);
+}
+
+/**
+ * Clock cycles between two boot timer values, the earlier one first.
+ */
+static inline uint32_t os_arch_boot_timer_cycles(uint32_t from, uint32_t to) {
+  return (from - to) * (BOOT_TIMER_SCALER + 1);
+}
+#endif
+
+#if defined(CONFIG_BOOT_PROFILE)
+/**
+ * Clock cycles from reset to each boot step, kept in memory to be read
+ * with the debugger.
+ */
+uint32_t os_arch_boot_time[OS_ARCH_BOOT_STEP_COUNT];
+
+static const char *const os_arch_boot_step_name[OS_ARCH_BOOT_STEP_COUNT] = {
+    "reset", "kernel entry", "MMU on", "tasks created", "first dispatch"};
+
+/**
+ * Record the time of a boot step. The timer was started at reset.
+ */
+void os_arch_boot_stamp(os_arch_boot_step_t step) {
+  os_arch_boot_time[step] =
+      os_arch_boot_timer_cycles(0xffffffff, os_arch_boot_timer_read());
+}
+
+/**
+ * Print the boot steps with their time from reset and from the previous
+ * step.
+ */
+void os_arch_boot_report(void) {
+  int step;
+
+  for (step = OS_ARCH_BOOT_RESET; step < OS_ARCH_BOOT_STEP_COUNT; step++) {
+    printf("[BOOT] %s: %u cycles (+%u)\n", os_arch_boot_step_name[step],
+           (unsigned int)os_arch_boot_time[step],
+           (unsigned int)(step ? os_arch_boot_time[step] -
+                                     os_arch_boot_time[step - 1]
+                               : 0));
+  }
+}
+#endif
+
+#if defined(CONFIG_IDLE_STATS)
+/**
+ * Idle instrumentation, kept in memory to be read with the debugger.
+ * The cycle counts come from the boot timer: the wake latency runs from
+ * the interrupt trap taken in power-down to the idle exit, on the way
+ * to the interrupt routing. The cycle totals wrap around.
+ */
+struct os_arch_idle_stats {
+  uint32_t power_down;        /**< power-down entries */
+  uint32_t irq_wakeup;        /**< wake-ups through an interrupt trap */
+  uint32_t spurious_wakeup;   /**< wake-ups without interrupt trap */
+  uint32_t wake_rounds;       /**< power-down rounds of the current idle */
+  uint32_t max_wake_rounds;   /**< worst number of rounds before a wake-up */
+  uint32_t last_wake_cycles;  /**< wake latency of the last wake-up */
+  uint32_t max_wake_cycles;   /**< worst wake latency */
+  uint32_t total_wake_cycles; /**< wake latency of all the wake-ups */
+  uint32_t total_idle_cycles; /**< time spent powered down */
+} os_arch_idle_stats;
+
+#if defined(CONFIG_BOOT_TIMER)
+/**
+ * Boot timer value stamped by the idle trap path.
+ */
+uint32_t os_arch_idle_wake_counter;
+#endif
+#endif
+
+/**
+ * Power down with interrupts enabled (PIL 0). An interrupt taken there
+ * goes through the kernel idle trap path which raises PIL back to 15
+ * and returns right after the power-down instruction. The line is left
+ * pending for the scheduler to route.
+ * A line raised between the PIL write and the power-down is still
+ * pending so the power-down returns immediately.
+ */
 void os_arch_idle(void) {
+  uint32_t psr;
+  uint32_t wake_psr;
+#if defined(CONFIG_IDLE_STATS) && defined(CONFIG_BOOT_TIMER)
+  uint32_t enter_counter;
+  uint32_t exit_counter;
+#endif
+
+  os_arch_interrupt_idle_enter();
+
+#if defined(CONFIG_IDLE_STATS) && defined(CONFIG_BOOT_TIMER)
+  enter_counter = os_arch_boot_timer_read();
+#endif
+
   /* For LEON3 or LEON4 */
-  asm volatile("wr %g0, %asr19");
+  asm volatile("rd %%psr, %0\n\t"
+               "andn %0, %2, %1\n\t"
+               "wr %1, %%psr\n\t"
+               "nop; nop; nop\n\t"
+               "wr %%g0, %%asr19\n\t"
+               "rd %%psr, %1\n\t"
+               "wr %0, %%psr\n\t"
+               "nop; nop; nop\n\t"
+               : "=&r"(psr), "=&r"(wake_psr)
+               : "i"(PSR_PIL_MASK)
+               : "cc", "memory");
+
+  os_arch_interrupt_idle_exit();
+
+#if defined(CONFIG_IDLE_STATS) && defined(CONFIG_BOOT_TIMER)
+  exit_counter = os_arch_boot_timer_read();
+#endif
+
+#if defined(CONFIG_IDLE_STATS)
+  os_arch_idle_stats.power_down++;
+  os_arch_idle_stats.wake_rounds++;
+
+  if (wake_psr & PSR_PIL_MASK) {
+    /* The idle trap path raised PIL: we got woken up by an interrupt */
+    os_arch_idle_stats.irq_wakeup++;
+
+    if (os_arch_idle_stats.wake_rounds > os_arch_idle_stats.max_wake_rounds) {
+      os_arch_idle_stats.max_wake_rounds = os_arch_idle_stats.wake_rounds;
+    }
+
+#if defined(CONFIG_BOOT_TIMER)
+    os_arch_idle_stats.total_idle_cycles +=
+        os_arch_boot_timer_cycles(enter_counter, os_arch_idle_wake_counter);
+    os_arch_idle_stats.last_wake_cycles =
+        os_arch_boot_timer_cycles(os_arch_idle_wake_counter, exit_counter);
+    os_arch_idle_stats.total_wake_cycles += os_arch_idle_stats.last_wake_cycles;
+
+    if (os_arch_idle_stats.last_wake_cycles >
+        os_arch_idle_stats.max_wake_cycles) {
+      os_arch_idle_stats.max_wake_cycles = os_arch_idle_stats.last_wake_cycles;
+
+      printf("[IDLE] max wake latency: %u cycles (total %u over %u "
+             "wake-ups)\n",
+             (unsigned int)os_arch_idle_stats.max_wake_cycles,
+             (unsigned int)os_arch_idle_stats.total_wake_cycles,
+             (unsigned int)os_arch_idle_stats.irq_wakeup);
+    }
+#endif
+
+    syslog("%s: woken up by interrupt after %d round(s)\n", __func__,
+           (int)os_arch_idle_stats.wake_rounds);
+
+    os_arch_idle_stats.wake_rounds = 0;
+  } else {
+    os_arch_idle_stats.spurious_wakeup++;
+#if defined(CONFIG_BOOT_TIMER)
+    os_arch_idle_stats.total_idle_cycles +=
+        os_arch_boot_timer_cycles(enter_counter, exit_counter);
+#endif
+  }
+#else
+  (void)wake_psr;
+#endif
 }
@@ -33,6 +33,11 @@
 /* for function prototypes for this file */
 #include <os_arch.h>
 
+#if defined(CONFIG_BOOT_PROFILE)
+/* for os_arch_boot_stamp() */
+#include <os_arch_boot.h>
+#endif
+
 /**
  * Switch adress space in MMU (context register).
  */
@@ -105,6 +110,10 @@ void os_arch_space_init(void) {
 
   syslog("%s: MMU enabling done\n", __func__);
 
+#if defined(CONFIG_BOOT_PROFILE)
+  os_arch_boot_stamp(OS_ARCH_BOOT_MMU_ON);
+#endif
+
   /*
    * From there we are in virtual memmory mode. It just so happen that for
    * The kernel we are in identity mapping (logical = physical).
@@ -30,7 +30,14 @@
 extern "C" {
 #endif
 
-typedef uint32_t os_mbx_mask_t;
+/* A mbx mask has one bit per task, in as many 32 bits words as needed */
+#define OS_MBX_MASK_WORD_SZ 32
+#define OS_MBX_MASK_WORD_CNT                                                   \
+  ((CONFIG_MAX_TASK_COUNT + OS_MBX_MASK_WORD_SZ - 1) / OS_MBX_MASK_WORD_SZ)
+
+typedef struct {
+  uint32_t word[OS_MBX_MASK_WORD_CNT];
+} os_mbx_mask_t;
 
 typedef int8_t os_task_id_t;
 
@@ -46,6 +53,12 @@ typedef uint32_t os_mbx_msg_t;
 typedef uint64_t os_mbx_msg_t;
 #endif
 
+/* A mbx message is passed to/from the kernel in two 32 bits registers */
+#define OS_MBX_MSG_HI(msg) ((uint32_t)((uint64_t)(msg) >> 32))
+#define OS_MBX_MSG_LO(msg) ((uint32_t)(msg))
+#define OS_MBX_MSG(hi, lo)                                                     \
+  ((os_mbx_msg_t)(((uint64_t)(hi) << 32) | (uint64_t)(lo)))
+
 typedef uint32_t os_virtual_address_t;
 
 typedef struct {
@@ -53,6 +66,18 @@ typedef struct {
   os_mbx_msg_t msg;
 } os_mbx_entry_t;
 
+typedef struct {
+  os_task_id_t dest_id;
+  os_mbx_msg_t msg;
+} os_mbx_send_entry_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t free;
+  uint32_t dropped;
+  os_mbx_mask_t posted_mask;
+} os_mbx_query_t;
+
 typedef struct {
   os_virtual_address_t virtual_address;
   uint32_t size;
@@ -60,16 +85,54 @@ typedef struct {
 
 typedef struct {
   uint8_t priority;
+  uint8_t mbx_count;
+  uint8_t mbx_overflow;
   os_mbx_mask_t mbx_permission;
+  os_mbx_mask_t mbx_urgent;
   os_task_section_t text;
   os_task_section_t bss;
   os_task_section_t stack;
+  os_task_section_t rodata;
 } os_task_ro_t;
 
 #define OS_TASK_ID_NONE -1
 #define OS_TASK_ID_ALL -2
 
-#define OS_MBX_MASK_ALL 0xffffffff
+#define OS_MBX_MASK_ALL                                                        \
+  ((os_mbx_mask_t){{[0 ... OS_MBX_MASK_WORD_CNT - 1] = 0xffffffff}})
+#define OS_MBX_MASK_NONE ((os_mbx_mask_t){{0}})
+
+/* Bit of a task in a given word of a mbx mask (0 if in another word) */
+#define OS_MBX_MASK_BIT(word, id)                                              \
+  ((((id) / OS_MBX_MASK_WORD_SZ) == (word))                                    \
+       ? (1U << ((id) % OS_MBX_MASK_WORD_SZ))                                  \
+       : 0U)
+
+/*
+ * A single word mbx mask is passed to the kernel in a register. A wider
+ * mask is passed by address.
+ */
+#if OS_MBX_MASK_WORD_CNT == 1
+#define OS_MBX_MASK_TO_REG(mask) ((mask).word[0])
+#else
+#define OS_MBX_MASK_TO_REG(mask) ((uint32_t)(mask).word)
+#endif
+
+static inline void os_mbx_mask_set(os_mbx_mask_t *mask, os_task_id_t id) {
+  mask->word[id / OS_MBX_MASK_WORD_SZ] |= 1U << (id % OS_MBX_MASK_WORD_SZ);
+}
+
+static inline int os_mbx_mask_test(const os_mbx_mask_t *mask,
+                                   os_task_id_t id) {
+  return (mask->word[id / OS_MBX_MASK_WORD_SZ] >>
+          (id % OS_MBX_MASK_WORD_SZ)) & 1;
+}
+
+/* Policy applied when a mbx is sent to a task whose FIFO is full */
+#define OS_MBX_OVERFLOW_REJECT 0
+#define OS_MBX_OVERFLOW_DROP_NEWEST 1
+#define OS_MBX_OVERFLOW_DROP_OLDEST 2
+#define OS_MBX_OVERFLOW_COALESCE 3
 
 #define OS_SUCCESS 0
 #define OS_ERROR_FIFO_FULL -1
@@ -77,17 +140,48 @@ typedef struct {
 #define OS_ERROR_DENIED -3
 #define OS_ERROR_RECEIVE -4
 #define OS_ERROR_PARAM -5
+/* The destination FIFO was full and its policy dropped the new mbx */
+#define OS_ERROR_DROPPED -6
 
 os_task_id_t os_sched_get_current_task_id(void);
 void os_sched_wait(os_task_id_t *, os_mbx_mask_t);
 void os_sched_yield(os_task_id_t *);
+uint8_t os_sched_yield_is_noop(void);
 void os_sched_exit(os_task_id_t *);
+void os_sched_wait_notify(os_task_id_t *);
 void os_init(os_task_id_t *);
+void os_mbx_query(os_mbx_query_t *);
 void os_mbx_receive(os_status_t *, os_mbx_entry_t *);
 void os_mbx_send(os_status_t *, os_task_id_t, os_mbx_msg_t);
+void os_mbx_send_wait(os_status_t *, os_task_id_t *, os_task_id_t,
+                      os_mbx_msg_t);
+void os_mbx_send_wait_status(os_status_t *);
+void os_mbx_receive_batch(os_status_t *, uint32_t *, uint32_t,
+                          os_mbx_entry_t *);
+void os_mbx_send_batch(os_status_t *, uint32_t, const os_mbx_send_entry_t *,
+                       os_status_t *);
+void os_mbx_notify(os_status_t *, os_task_id_t, uint32_t);
+void os_mbx_notify_take(uint32_t *);
+void os_mbx_irq_route(void);
+void os_mbx_irq_ack(os_status_t *, uint32_t);
+void os_mbx_call(os_status_t *, os_task_id_t *, os_task_id_t, os_mbx_msg_t);
+void os_mbx_reply_wait(os_status_t *, os_task_id_t *, os_task_id_t,
+                       os_mbx_msg_t, os_mbx_mask_t);
+
+typedef struct {
+  uint8_t count;
+  os_task_id_t receiver[CONFIG_MAX_TASK_COUNT];
+} os_task_broadcast_t;
 
 extern os_task_ro_t const os_task_ro[CONFIG_MAX_TASK_COUNT];
 
+extern os_task_broadcast_t const os_task_broadcast[CONFIG_MAX_TASK_COUNT];
+
+/* An interrupt line is notified to its owner task with the same bit */
+#define OS_IRQ_MAX 32
+
+extern os_task_id_t const os_irq_owner[OS_IRQ_MAX];
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,16 @@ extern "C" {
 
 uint8_t os_arch_interrupt_is_pending(void);
 
+void os_arch_interrupt_init(void);
+
+void os_arch_interrupt_take(uint32_t *irq_lines);
+
+void os_arch_interrupt_unmask(uint32_t irq);
+
+void os_arch_interrupt_idle_enter(void);
+
+void os_arch_interrupt_idle_exit(void);
+
 void os_arch_idle(void);
 
 void os_arch_context_create(os_task_id_t task_id);
@@ -22,7 +22,7 @@
 
 package body Moth.Config with
    SPARK_Mode    => On,
-   Refined_State => (State => (read_only_conf))
+   Refined_State => (State => (read_only_conf, broadcast_conf, irq_conf))
 is
    subtype os_virtual_address_t is types.uint32_t;
 
@@ -36,13 +36,26 @@ is
 
    type os_task_ro_t is record
       priority       : os_priority_t;
+      mbx_count      : os_mbx_depth_t;
+      mbx_overflow   : os_mbx_overflow_t;
       mbx_permission : os_mbx_mask_t;
+      mbx_urgent     : os_mbx_mask_t;
       text           : os_task_section_t;
       bss            : os_task_section_t;
       stack          : os_task_section_t;
+      rodata         : os_task_section_t;
    end record;
    pragma Convention (C_Pass_By_Copy, os_task_ro_t);
 
+   type os_task_receiver_t is array (os_task_id_param_t) of os_task_id_t;
+   pragma Convention (C, os_task_receiver_t);
+
+   type os_task_broadcast_t is record
+      count    : os_receiver_count_t;
+      receiver : os_task_receiver_t;
+   end record;
+   pragma Convention (C_Pass_By_Copy, os_task_broadcast_t);
+
    --------------------
    -- read_only_conf --
    --------------------
@@ -50,6 +63,24 @@ is
    read_only_conf : constant array (os_task_id_param_t) of os_task_ro_t;
    pragma Import (C, read_only_conf, "os_task_ro");
 
+   --------------------
+   -- broadcast_conf --
+   --------------------
+   --  For each task, the tasks accepting mbx from it. This is computed at
+   --  build time from the mbx permissions.
+
+   broadcast_conf : constant array (os_task_id_param_t) of os_task_broadcast_t;
+   pragma Import (C, broadcast_conf, "os_task_broadcast");
+
+   --------------
+   -- irq_conf --
+   --------------
+   --  For each interrupt line, the task it is routed to (or none). This is
+   --  generated at build time from the platform XML.
+
+   irq_conf : constant array (os_irq_t) of os_task_id_t;
+   pragma Import (C, irq_conf, "os_irq_owner");
+
    ------------------------
    -- get_mbx_permission --
    ------------------------
@@ -58,6 +89,30 @@ is
      (task_id : os_task_id_param_t) return os_mbx_mask_t is
      (read_only_conf (task_id).mbx_permission);
 
+   --------------------
+   -- get_mbx_urgent --
+   --------------------
+
+   function get_mbx_urgent
+     (task_id : os_task_id_param_t) return os_mbx_mask_t is
+     (read_only_conf (task_id).mbx_urgent);
+
+   -------------------
+   -- get_mbx_count --
+   -------------------
+
+   function get_mbx_count
+     (task_id : os_task_id_param_t) return os_mbx_depth_t is
+     (read_only_conf (task_id).mbx_count);
+
+   ----------------------
+   -- get_mbx_overflow --
+   ----------------------
+
+   function get_mbx_overflow
+     (task_id : os_task_id_param_t) return os_mbx_overflow_t is
+     (read_only_conf (task_id).mbx_overflow);
+
    -----------------------
    -- get_task_priority --
    -----------------------
@@ -66,4 +121,29 @@ is
      (task_id : os_task_id_param_t) return os_priority_t is
      (read_only_conf (task_id).priority);
 
+   ------------------------
+   -- get_receiver_count --
+   ------------------------
+
+   function get_receiver_count
+     (task_id : os_task_id_param_t) return os_receiver_count_t is
+     (broadcast_conf (task_id).count);
+
+   ------------------
+   -- get_receiver --
+   ------------------
+
+   function get_receiver
+     (task_id : os_task_id_param_t;
+      index   : os_task_id_param_t) return os_task_id_t is
+     (broadcast_conf (task_id).receiver (index));
+
+   -------------------
+   -- get_irq_owner --
+   -------------------
+
+   function get_irq_owner
+     (irq : os_irq_t) return os_task_id_t is
+     (irq_conf (irq));
+
 end Moth.Config;
@@ -24,11 +24,26 @@ with Interfaces;   use Interfaces;
 with Interfaces.C; use Interfaces.C;
 
 with Moth.Config;
+with os_arch;
 
 separate (Moth)
 package body Mailbox with
    SPARK_Mode => On,
-   Refined_State => (Mailbox_State => mbx_fifo)
+   Refined_State => (Mailbox_State => (mbx_fifo,
+                                       mbx_pool,
+                                       mbx_posted_mask,
+                                       mbx_dropped,
+                                       mbx_blocked_head,
+                                       mbx_blocked_tail,
+                                       mbx_blocked_next,
+                                       mbx_blocked_msg,
+                                       mbx_blocked_status,
+                                       mbx_closed,
+                                       notify_word,
+                                       mbx_owner,
+                                       mbx_position,
+                                       mbx_free_rank,
+                                       mbx_sender_prev))
 is
 
    -----------------
@@ -39,23 +54,60 @@ is
    -- Private types --
    -------------------
 
-   --  Max mbx count is provided through configuration
+   --  Max mbx count of a task is provided through configuration
    OS_MAX_MBX_CNT : constant := OpenConf.CONFIG_TASK_MBX_COUNT;
 
-   -- Type to define a mbx index
-   type os_mbx_index_t is mod OS_MAX_MBX_CNT;
+   --  Number of mbx slots shared by all tasks (provided by configuration)
+   OS_MBX_POOL_CNT : constant := OpenConf.CONFIG_MBX_POOL_COUNT;
+
+   --  Value of a mbx link that does not point to any slot
+   OS_MBX_INDEX_NONE : constant := -1;
+
+   --  Type to define a link to a mbx slot (or no slot)
+   subtype os_mbx_link_t is
+     types.int8_t range OS_MBX_INDEX_NONE .. OS_MBX_POOL_CNT - 1;
+
+   --  Type to define a mbx slot index
+   subtype os_mbx_index_t is os_mbx_link_t range 0 .. OS_MBX_POOL_CNT - 1;
 
    --  Type to define the number of mbx in the task FIFO
    subtype os_mbx_count_t is types.uint8_t range 0 .. OS_MAX_MBX_CNT;
 
-   --  Type to define the task FIFO
-   type os_mbx_t_array is array (os_mbx_index_t) of os_mbx_entry_t;
+   --  Type to define the first pool slot of a task
+   subtype os_mbx_base_t is Natural range 0 .. OS_MBX_POOL_CNT;
+
+   --  Type to define the arrival order of a mbx. As there are never more
+   --  than OS_MAX_MBX_CNT mbx in a FIFO, the distance from the FIFO head
+   --  sequence number gives the arrival order without ambiguity.
+   type os_mbx_seq_t is mod 2**8;
+
+   --  This structure holds one mbx and its links:
+   --  + next/prev link the mbx in the FIFO arrival order (next also links
+   --    the free slots together).
+   --  + sender_next links the mbx with the next mbx from the same sender.
+   --  + sender_tail is the last mbx from the same sender if this mbx is
+   --    the oldest one from its sender (the sub-queue head). It does not
+   --    point to any slot otherwise.
+   type os_mbx_slot_t is record
+      mbx_entry   : os_mbx_entry_t;
+      seq         : os_mbx_seq_t;
+      next        : os_mbx_link_t;
+      prev        : os_mbx_link_t;
+      sender_next : os_mbx_link_t;
+      sender_tail : os_mbx_link_t;
+   end record;
 
-   --  This structure allows to manage mbx for one task
+   --  This structure allows to manage mbx for one task. The slots of the
+   --  task are taken from the shared pool (depth slots from base). The
+   --  free list only links slots of this task.
    type os_mbx_t is record
-      head      : os_mbx_index_t;
-      count     : os_mbx_count_t;
-      mbx_array : os_mbx_t_array;
+      head  : os_mbx_link_t;
+      tail  : os_mbx_link_t;
+      free  : os_mbx_link_t;
+      count : os_mbx_count_t;
+      depth : os_mbx_count_t;
+      base  : os_mbx_base_t;
+      seq   : os_mbx_seq_t;
    end record;
 
    -----------------------
@@ -64,19 +116,132 @@ is
 
    mbx_fifo : array (os_task_id_param_t) of os_mbx_t;
 
-   ----------------------------------
-   -- Private functions/procedures --
-   ----------------------------------
+   --------------
+   -- mbx_pool --
+   --------------
+   --  The mbx slots of all tasks. Each task owns a contiguous range of
+   --  slots whose size is the task mbx depth from the platform XML, so the
+   --  kernel bss is not sized for the worst case on every task.
+
+   mbx_pool : array (os_mbx_index_t) of os_mbx_slot_t;
+
+   ---------------------
+   -- mbx_posted_mask --
+   ---------------------
+   --  For each task, one bit per sender with at least one mbx in the task
+   --  FIFO. It is updated each time a mbx is added or removed so that the
+   --  FIFO never needs to be scanned to build it.
+
+   mbx_posted_mask : array (os_task_id_param_t) of os_mbx_mask_t;
+
+   -----------------
+   -- mbx_dropped --
+   -----------------
+   --  For each task, the number of mbx lost because of its overflow policy
+   --  (saturates at its max value).
+
+   mbx_dropped : array (os_task_id_param_t) of types.uint32_t;
 
    ----------------------
-   -- + os_mbx_index_t --
+   -- mbx_blocked_head --
    ----------------------
-   --  add operator overload for os_mbx_index_t
+   --  For each task, the first sender blocked because its FIFO is full.
+   --  The blocked senders are queued in arrival order.
 
-   function "+" (Left  : os_mbx_index_t;
-                 Right : os_mbx_count_t) return os_mbx_index_t
-   is
-     (Left + os_mbx_index_t'Mod (Right));
+   mbx_blocked_head : array (os_task_id_param_t) of os_task_id_t;
+
+   ----------------------
+   -- mbx_blocked_tail --
+   ----------------------
+   --  For each task, the last sender blocked because its FIFO is full.
+
+   mbx_blocked_tail : array (os_task_id_param_t) of os_task_id_t;
+
+   ----------------------
+   -- mbx_blocked_next --
+   ----------------------
+   --  For each blocked sender, the next sender blocked on the same FIFO.
+   --  A sender is blocked on one FIFO at most.
+
+   mbx_blocked_next : array (os_task_id_param_t) of os_task_id_t;
+
+   ---------------------
+   -- mbx_blocked_msg --
+   ---------------------
+   --  For each blocked sender, the mbx it is trying to send.
+
+   mbx_blocked_msg : array (os_task_id_param_t) of os_mbx_msg_t;
+
+   ------------------------
+   -- mbx_blocked_status --
+   ------------------------
+   --  For each blocked sender, the status of its send once it is ready
+   --  again.
+
+   mbx_blocked_status : array (os_task_id_param_t) of os_status_t;
+
+   ----------------
+   -- mbx_closed --
+   ----------------
+   --  The tasks that exited for good. No sender can block on their FIFO.
+
+   mbx_closed : array (os_task_id_param_t) of Boolean;
+
+   -----------------
+   -- notify_word --
+   -----------------
+   --  For each task, the notification bits posted and not yet taken.
+
+   notify_word : array (os_task_id_param_t) of os_notify_word_t;
+
+   ---------------------
+   -- Ghost variables --
+   ---------------------
+   --  They are only used by the provers to track the lists of slots.
+
+   ---------------
+   -- mbx_owner --
+   ---------------
+   --  For each pool slot, the task owning the slot (no task if the slot
+   --  is not in the range of any task). It does not change after init.
+
+   mbx_owner : array (os_mbx_index_t) of os_task_id_t
+   with
+      Ghost => True;
+
+   ------------------
+   -- mbx_position --
+   ------------------
+   --  For each used slot, its position in the FIFO of its task (0 for the
+   --  FIFO head).
+
+   mbx_position : array (os_mbx_index_t) of Natural
+   with
+      Ghost => True;
+
+   -------------------
+   -- mbx_free_rank --
+   -------------------
+   --  For each free slot, the number of free slots after it in the free
+   --  list of its task.
+
+   mbx_free_rank : array (os_mbx_index_t) of Natural
+   with
+      Ghost => True;
+
+   ---------------------
+   -- mbx_sender_prev --
+   ---------------------
+   --  For each used slot, the previous mbx from the same sender (the
+   --  reverse of sender_next).
+
+   mbx_sender_prev : array (os_mbx_index_t) of os_mbx_link_t
+   with
+      Ghost => True;
+
+   ----------------------------------
+   -- Private functions/procedures --
+   ----------------------------------
 
    ---------------------
    -- mbx_is_empty --
@@ -94,14 +259,14 @@ is
 
    function mbx_is_full (task_id : os_task_id_param_t) return Boolean
    is
-     (mbx_fifo (task_id).count = os_mbx_count_t'Last);
+     (mbx_fifo (task_id).count = mbx_fifo (task_id).depth);
 
    -------------------------
    -- get_mbx_head --
    -------------------------
-   --  Retrieve the mbx head index of the given task.
+   --  Retrieve the mbx head index (oldest mbx) of the given task.
 
-   function get_mbx_head (task_id : os_task_id_param_t) return os_mbx_index_t
+   function get_mbx_head (task_id : os_task_id_param_t) return os_mbx_link_t
    is
      (mbx_fifo (task_id).head);
 
@@ -114,86 +279,866 @@ is
    is
      (mbx_fifo (task_id).count);
 
-   ------------------
-   -- get_mbx_tail --
-   ------------------
-   --  Retrieve the mbx tail index of the given task.
+   --------------------------
+   -- get_mbx_entry_sender --
+   --------------------------
 
-   function get_mbx_tail (task_id : os_task_id_param_t) return os_mbx_index_t
+   function get_mbx_entry_sender (task_id : os_task_id_param_t;
+                                  index   : os_mbx_index_t)
+                                  return os_task_id_param_t
    is
-     (get_mbx_head (task_id) + os_mbx_count_t'Pred (get_mbx_count (task_id)))
+     (os_task_id_param_t
+        (mbx_pool (index).mbx_entry.sender_id))
    with
-     Pre => not mbx_is_empty (task_id);
+      Pre => mbx_pool (index).mbx_entry.sender_id in
+               os_task_id_param_t;
 
-      ---------------------
-      -- mbx_add_message --
-      ---------------------
-      --  Add a mbx to the mbx fifo of a given task.
+   -------------------
+   -- get_mbx_entry --
+   -------------------
+
+   function get_mbx_entry (task_id : os_task_id_param_t;
+                           index   : os_mbx_index_t) return os_mbx_entry_t
+   is
+     (mbx_pool (index).mbx_entry);
+
+   ----------------------
+   --  Ghost functions --
+   ----------------------
+
+   ----------------------
+   -- mbx_slot_is_used --
+   ----------------------
+   --  Check if a pool slot holds a mbx.
+
+   function mbx_slot_is_used (index : os_mbx_index_t) return Boolean
+   is
+     (mbx_pool (index).mbx_entry.sender_id /= OS_TASK_ID_NONE)
+   with
+      Ghost => True;
+
+   -----------------------
+   -- mbx_slot_is_owned --
+   -----------------------
+   --  Check if a pool slot is one of the slots of the given task.
+
+   function mbx_slot_is_owned (task_id : os_task_id_param_t;
+                               index   : os_mbx_index_t) return Boolean
+   is
+     (mbx_owner (index) = task_id)
+   with
+      Ghost => True;
+
+   -----------------------
+   -- mbx_slot_in_range --
+   -----------------------
+   --  Check if a pool slot is in the slot range of the given task.
+
+   function mbx_slot_in_range (task_id : os_task_id_param_t;
+                               index   : os_mbx_index_t) return Boolean
+   is
+     (Natural (index) >= mbx_fifo (task_id).base
+      and then Natural (index) < mbx_fifo (task_id).base +
+                                 Natural (mbx_fifo (task_id).depth))
+   with
+      Ghost => True;
+
+   ---------------------
+   -- mbx_sender_last --
+   ---------------------
+   --  Tail of the sub-queue of a sender given its sub-queue head.
+
+   function mbx_sender_last (first_id : os_mbx_link_t) return os_mbx_link_t
+   is
+     (if first_id = OS_MBX_INDEX_NONE then OS_MBX_INDEX_NONE
+      else mbx_pool (first_id).sender_tail)
+   with
+      Ghost => True;
+
+   -------------------------
+   -- mbx_are_well_formed --
+   -------------------------
+
+   --  Invariant 1: the slots of each task are its range of the pool.
+   function mbx_owner_are_well_formed return Boolean is
+     (for all task_id in os_task_id_param_t'Range =>
+        mbx_fifo (task_id).base + Natural (mbx_fifo (task_id).depth) <=
+        OS_MBX_POOL_CNT
+        and then (for all index in os_mbx_index_t'Range =>
+                    mbx_slot_is_owned (task_id, index) =
+                    mbx_slot_in_range (task_id, index)))
+   with
+      Ghost => True;
+
+   --  Invariant 2: the ends of the FIFO and the free list of a task. The
+   --  FIFO head is the oldest mbx of all, so it is also the head of its
+   --  sender sub-queue.
+   function mbx_fifo_is_well_formed (task_id : os_task_id_param_t)
+                                     return Boolean
+   is
+     (get_mbx_count (task_id) <= mbx_fifo (task_id).depth
+      and then (get_mbx_count (task_id) = 0) =
+               (get_mbx_head (task_id) = OS_MBX_INDEX_NONE)
+      and then (get_mbx_count (task_id) = 0) =
+               (mbx_fifo (task_id).tail = OS_MBX_INDEX_NONE)
+      and then (get_mbx_count (task_id) = mbx_fifo (task_id).depth) =
+               (mbx_fifo (task_id).free = OS_MBX_INDEX_NONE)
+      and then (if get_mbx_head (task_id) /= OS_MBX_INDEX_NONE then
+                  mbx_slot_is_owned (task_id, get_mbx_head (task_id))
+                  and then mbx_slot_is_used (get_mbx_head (task_id))
+                  and then mbx_pool (get_mbx_head (task_id)).prev =
+                           OS_MBX_INDEX_NONE
+                  and then mbx_position (get_mbx_head (task_id)) = 0
+                  and then mbx_pool (get_mbx_head (task_id)).sender_tail /=
+                           OS_MBX_INDEX_NONE)
+      and then (if mbx_fifo (task_id).tail /= OS_MBX_INDEX_NONE then
+                  mbx_slot_is_owned (task_id, mbx_fifo (task_id).tail)
+                  and then mbx_slot_is_used (mbx_fifo (task_id).tail)
+                  and then mbx_pool (mbx_fifo (task_id).tail).next =
+                           OS_MBX_INDEX_NONE
+                  and then mbx_position (mbx_fifo (task_id).tail) =
+                           Natural (get_mbx_count (task_id)) - 1)
+      and then (if mbx_fifo (task_id).free /= OS_MBX_INDEX_NONE then
+                  mbx_slot_is_owned (task_id, mbx_fifo (task_id).free)
+                  and then not mbx_slot_is_used (mbx_fifo (task_id).free)
+                  and then mbx_free_rank (mbx_fifo (task_id).free) =
+                           Natural (mbx_fifo (task_id).depth) -
+                           Natural (get_mbx_count (task_id)) - 1))
+   with
+      Ghost => True;
+
+   --  Invariant 3: the links of a slot. A free slot only links the next
+   --  free slot of its task. A used slot is linked in the FIFO of its task
+   --  (doubly) and in the sub-queue of its sender (doubly with the ghost
+   --  sender_prev). Only the sub-queue head knows the sub-queue tail.
+   function mbx_slot_is_well_formed (index : os_mbx_index_t) return Boolean
+   is
+     (if not mbx_slot_is_used (index) then
+         mbx_pool (index).prev = OS_MBX_INDEX_NONE
+         and then mbx_pool (index).sender_next = OS_MBX_INDEX_NONE
+         and then mbx_pool (index).sender_tail = OS_MBX_INDEX_NONE
+         and then mbx_sender_prev (index) = OS_MBX_INDEX_NONE
+         and then
+         (if mbx_owner (index) in os_task_id_param_t then
+            mbx_free_rank (index) <
+            Natural (mbx_fifo (mbx_owner (index)).depth) -
+            Natural (mbx_fifo (mbx_owner (index)).count)
+            and then (mbx_pool (index).next = OS_MBX_INDEX_NONE) =
+                     (mbx_free_rank (index) = 0)
+            and then
+            (if mbx_pool (index).next /= OS_MBX_INDEX_NONE then
+               mbx_owner (mbx_pool (index).next) = mbx_owner (index)
+               and then not mbx_slot_is_used (mbx_pool (index).next)
+               and then mbx_free_rank (mbx_pool (index).next) =
+                        mbx_free_rank (index) - 1))
+      else
+         mbx_pool (index).mbx_entry.sender_id in os_task_id_param_t
+         and then mbx_owner (index) in os_task_id_param_t
+         and then mbx_position (index) <
+                  Natural (mbx_fifo (mbx_owner (index)).count)
+         and then
+         (if mbx_pool (index).next /= OS_MBX_INDEX_NONE then
+            mbx_owner (mbx_pool (index).next) = mbx_owner (index)
+            and then mbx_slot_is_used (mbx_pool (index).next)
+            and then mbx_pool (mbx_pool (index).next).prev = index
+            and then mbx_position (mbx_pool (index).next) =
+                     mbx_position (index) + 1
+          else
+            mbx_fifo (mbx_owner (index)).tail = index)
+         and then
+         (if mbx_pool (index).prev /= OS_MBX_INDEX_NONE then
+            mbx_owner (mbx_pool (index).prev) = mbx_owner (index)
+            and then mbx_slot_is_used (mbx_pool (index).prev)
+            and then mbx_pool (mbx_pool (index).prev).next = index
+            and then mbx_position (index) =
+                     mbx_position (mbx_pool (index).prev) + 1
+          else
+            mbx_fifo (mbx_owner (index)).head = index)
+         and then
+         (if mbx_pool (index).sender_next /= OS_MBX_INDEX_NONE then
+            mbx_owner (mbx_pool (index).sender_next) = mbx_owner (index)
+            and then mbx_slot_is_used (mbx_pool (index).sender_next)
+            and then mbx_pool (mbx_pool (index).sender_next)
+                       .mbx_entry.sender_id =
+                     mbx_pool (index).mbx_entry.sender_id
+            and then mbx_sender_prev (mbx_pool (index).sender_next) = index
+            and then mbx_position (mbx_pool (index).sender_next) >
+                     mbx_position (index))
+         and then
+         (if mbx_sender_prev (index) /= OS_MBX_INDEX_NONE then
+            mbx_owner (mbx_sender_prev (index)) = mbx_owner (index)
+            and then mbx_slot_is_used (mbx_sender_prev (index))
+            and then mbx_pool (mbx_sender_prev (index)).mbx_entry.sender_id =
+                     mbx_pool (index).mbx_entry.sender_id
+            and then mbx_pool (mbx_sender_prev (index)).sender_next = index
+            and then mbx_position (mbx_sender_prev (index)) <
+                     mbx_position (index))
+         and then (mbx_sender_prev (index) = OS_MBX_INDEX_NONE) =
+                  (mbx_pool (index).sender_tail /= OS_MBX_INDEX_NONE)
+         and then
+         (if mbx_pool (index).sender_tail /= OS_MBX_INDEX_NONE then
+            mbx_owner (mbx_pool (index).sender_tail) = mbx_owner (index)
+            and then mbx_slot_is_used (mbx_pool (index).sender_tail)
+            and then mbx_pool (mbx_pool (index).sender_tail)
+                       .mbx_entry.sender_id =
+                     mbx_pool (index).mbx_entry.sender_id
+            and then mbx_pool (mbx_pool (index).sender_tail).sender_next =
+                     OS_MBX_INDEX_NONE))
+   with
+      Ghost => True;
+
+   --  Invariant 4: a task has one sub-queue head per sender at most, and
+   --  the posted mask tells which senders have one.
+   function mbx_sender_are_well_formed return Boolean is
+     ((for all task_id in os_task_id_param_t'Range =>
+         (for all sender_id in os_task_id_param_t'Range =>
+            mbx_mask_test (mbx_posted_mask (task_id), sender_id) =
+            (for some index in os_mbx_index_t'Range =>
+               mbx_slot_is_owned (task_id, index)
+               and then mbx_slot_is_used (index)
+               and then mbx_pool (index).sender_tail /= OS_MBX_INDEX_NONE
+               and then mbx_pool (index).mbx_entry.sender_id = sender_id)))
+      and then
+      (for all first in os_mbx_index_t'Range =>
+         (for all other in os_mbx_index_t'Range =>
+            (if mbx_slot_is_used (first)
+                and then mbx_slot_is_used (other)
+                and then mbx_owner (first) = mbx_owner (other)
+                and then mbx_pool (first).sender_tail /= OS_MBX_INDEX_NONE
+                and then mbx_pool (other).sender_tail /= OS_MBX_INDEX_NONE
+                and then mbx_pool (first).mbx_entry.sender_id =
+                         mbx_pool (other).mbx_entry.sender_id
+             then
+                first = other))))
+   with
+      Ghost => True;
+
+   --  Invariant 5: the free slots of a task have different ranks, so the
+   --  free list is a list of depth - count slots.
+   function mbx_free_are_well_formed return Boolean is
+     (for all first in os_mbx_index_t'Range =>
+        (for all other in os_mbx_index_t'Range =>
+           (if not mbx_slot_is_used (first)
+               and then not mbx_slot_is_used (other)
+               and then mbx_owner (first) in os_task_id_param_t
+               and then mbx_owner (first) = mbx_owner (other)
+               and then mbx_free_rank (first) = mbx_free_rank (other)
+            then
+               first = other)))
+   with
+      Ghost => True;
+
+   --  Combined invariant
+   function mbx_are_well_formed return Boolean is
+     (mbx_owner_are_well_formed
+      and then (for all task_id in os_task_id_param_t'Range =>
+                  mbx_fifo_is_well_formed (task_id))
+      and then (for all index in os_mbx_index_t'Range =>
+                  mbx_slot_is_well_formed (index))
+      and then mbx_sender_are_well_formed
+      and then mbx_free_are_well_formed);
+
+   ----------------------------
+   -- lemma_head_of_position --
+   ----------------------------
+   --  A used slot at position 0 has no previous slot (the previous slot
+   --  would be at position -1), so it is the head of the FIFO of its task.
+
+   procedure lemma_head_of_position (index : os_mbx_index_t)
+   with
+      Ghost  => True,
+      Pre    => mbx_slot_is_used (index)
+                and then mbx_slot_is_well_formed (index)
+                and then mbx_position (index) = 0,
+      Post   => mbx_owner (index) in os_task_id_param_t
+                and then mbx_pool (index).prev = OS_MBX_INDEX_NONE
+                and then get_mbx_head (mbx_owner (index)) = index
+   is
+   begin
+      null;
+   end lemma_head_of_position;
+
+   ---------------------
+   -- mbx_sender_head --
+   ---------------------
+   --  Find the oldest mbx from a sender in the FIFO of a task. Only the
+   --  slots of the task are visited, so the cost is bounded by its FIFO
+   --  depth (and there is nothing to look for if the sender posted no mbx).
+
+   function mbx_sender_head (task_id   : os_task_id_param_t;
+                             sender_id : os_task_id_param_t)
+                             return os_mbx_link_t
+   with
+      Pre  => mbx_are_well_formed,
+      Post => (if mbx_sender_head'Result /= OS_MBX_INDEX_NONE then
+                 mbx_slot_is_owned (task_id, mbx_sender_head'Result)
+                 and then mbx_pool (mbx_sender_head'Result).sender_tail /=
+                          OS_MBX_INDEX_NONE
+                 and then mbx_pool (mbx_sender_head'Result)
+                            .mbx_entry.sender_id = sender_id
+               else
+                 not mbx_mask_test (mbx_posted_mask (task_id), sender_id))
+   is
+      base : constant os_mbx_base_t := mbx_fifo (task_id).base;
+   begin
+      if mbx_mask_test (mbx_posted_mask (task_id), sender_id) then
+         for index in base .. base + Natural (mbx_fifo (task_id).depth) - 1
+         loop
+            pragma Loop_Invariant
+              (for all other in base .. index - 1 =>
+                 mbx_pool (os_mbx_index_t (other)).sender_tail =
+                 OS_MBX_INDEX_NONE
+                 or else mbx_pool (os_mbx_index_t (other))
+                           .mbx_entry.sender_id /= sender_id);
+
+            if mbx_pool (os_mbx_index_t (index)).sender_tail /=
+               OS_MBX_INDEX_NONE
+              and then mbx_pool (os_mbx_index_t (index)).mbx_entry.sender_id =
+                       sender_id
+            then
+               return os_mbx_index_t (index);
+            end if;
+         end loop;
+      end if;
+
+      return OS_MBX_INDEX_NONE;
+   end mbx_sender_head;
+
+   ---------------------
+   -- mbx_add_message --
+   ---------------------
+   --  Add a mbx to the mbx fifo of a given task. The mbx is linked at the
+   --  tail of the FIFO and at the tail of the sender sub-queue.
 
    procedure mbx_add_message (dest_id : os_task_id_param_t;
                               src_id  : os_task_id_param_t;
                               mbx_msg : os_mbx_msg_t)
    with
       Pre  => (not mbx_is_full (dest_id)) and then mbx_are_well_formed,
-      Post => (not mbx_is_empty (dest_id)) and then
-       (mbx_fifo = (mbx_fifo'Old with delta
-          dest_id => (mbx_fifo'Old(dest_id)  with delta
-               count     => mbx_fifo'Old(dest_id).count + 1,
-               head      => mbx_fifo'Old(dest_id).head,
-               mbx_array => (mbx_fifo'Old(dest_id).mbx_array with delta
-                    get_mbx_tail (dest_id) =>
-                       (sender_id => src_id, msg => mbx_msg)))))
-       and then mbx_are_well_formed
-   is
-      mbx_index : constant os_mbx_index_t :=
-        get_mbx_head (dest_id) + get_mbx_count (dest_id);
+      Post => (not mbx_is_empty (dest_id))
+              and then get_mbx_count (dest_id) =
+                       get_mbx_count (dest_id)'Old + 1
+              and then mbx_mask_test (mbx_posted_mask (dest_id), src_id)
+              and then mbx_are_well_formed
+              --  Only the new slot, the old FIFO tail and the head and tail
+              --  of the sender sub-queue are relinked.
+              and then (for all other in os_mbx_index_t'Range =>
+                          (if other /= mbx_fifo'Old (dest_id).free
+                              and then other /= mbx_fifo'Old (dest_id).tail
+                              and then other /=
+                                       mbx_sender_head (dest_id, src_id)'Old
+                              and then other /=
+                                       mbx_sender_last (mbx_sender_head
+                                                          (dest_id,
+                                                           src_id))'Old
+                           then
+                              mbx_pool (other) = mbx_pool'Old (other)))
+              and then (for all task_id in os_task_id_param_t'Range =>
+                          (if task_id /= dest_id then
+                              mbx_fifo (task_id) = mbx_fifo'Old (task_id)
+                              and then mbx_posted_mask (task_id) =
+                                       mbx_posted_mask'Old (task_id)))
+   is
+      index    : constant os_mbx_index_t := mbx_fifo (dest_id).free;
+      tail_id  : constant os_mbx_link_t  := mbx_fifo (dest_id).tail;
+      first_id : constant os_mbx_link_t  := mbx_sender_head (dest_id, src_id);
+      last_id  : constant os_mbx_link_t  := mbx_sender_last (first_id)
+      with
+         Ghost => True;
+      count    : constant Natural := Natural (mbx_fifo (dest_id).count)
+      with
+         Ghost => True;
    begin
+      --  The free list head has the highest free rank, so no free slot
+      --  links it.
+      pragma Assert (mbx_free_rank (index) =
+                     Natural (mbx_fifo (dest_id).depth) - count - 1);
+
+      --  Take the slot from the free list
+      mbx_fifo (dest_id).free := mbx_pool (index).next;
+
+      mbx_pool (index) :=
+        (mbx_entry   => (sender_id => src_id, msg => mbx_msg),
+         seq         => mbx_fifo (dest_id).seq,
+         next        => OS_MBX_INDEX_NONE,
+         prev        => tail_id,
+         sender_next => OS_MBX_INDEX_NONE,
+         sender_tail => (if first_id = OS_MBX_INDEX_NONE then index
+                         else OS_MBX_INDEX_NONE));
+
+      mbx_fifo (dest_id).seq   := mbx_fifo (dest_id).seq + 1;
       mbx_fifo (dest_id).count :=
         os_mbx_count_t'Succ (mbx_fifo (dest_id).count);
-      mbx_fifo (dest_id).mbx_array (mbx_index).sender_id := src_id;
-      mbx_fifo (dest_id).mbx_array (mbx_index).msg       := mbx_msg;
+
+      --  Link the slot at the tail of the FIFO
+      if tail_id = OS_MBX_INDEX_NONE then
+         mbx_fifo (dest_id).head := index;
+      else
+         mbx_pool (tail_id).next := index;
+      end if;
+
+      mbx_fifo (dest_id).tail := index;
+
+      --  Link the slot at the tail of the sender sub-queue
+      if first_id = OS_MBX_INDEX_NONE then
+         --  This is the first mbx from this sender
+         mbx_posted_mask (dest_id) :=
+           mbx_mask_set (mbx_posted_mask (dest_id), src_id);
+      else
+         mbx_pool (mbx_pool (first_id).sender_tail).sender_next := index;
+         mbx_pool (first_id).sender_tail := index;
+      end if;
+
+      --  The new mbx is the last one of the FIFO and of its sender
+      mbx_position (index)    := count;
+      mbx_sender_prev (index) := last_id;
+
+      --  Check the relinked slots first. The other slots keep their links
+      --  and the slots they link keep their back links.
+      pragma Assert (mbx_slot_is_well_formed (index));
+
+      if tail_id /= OS_MBX_INDEX_NONE then
+         pragma Assert (mbx_slot_is_well_formed (tail_id));
+      end if;
+
+      if first_id /= OS_MBX_INDEX_NONE then
+         pragma Assert (mbx_slot_is_well_formed (first_id));
+         pragma Assert (mbx_slot_is_well_formed (last_id));
+      end if;
+
+      pragma Assert (mbx_fifo_is_well_formed (dest_id));
+      pragma Assert (for all other in os_mbx_index_t'Range =>
+                       mbx_slot_is_well_formed (other));
+      pragma Assert (mbx_sender_are_well_formed);
+      pragma Assert (mbx_free_are_well_formed);
    end mbx_add_message;
 
+   -------------
+   -- get_mbx --
+   -------------
+   --  Find the oldest mbx from one of the waited senders. This is the oldest
+   --  head of the waited sender sub-queues, so the cost does not depend on
+   --  the number of mbx in the FIFO. The mbx from urgent senders (from the
+   --  platform XML) are delivered first if any is posted.
+
+   function get_mbx (task_id : os_task_id_param_t;
+                     waited  : os_mbx_mask_t) return os_mbx_index_t
+   with
+      Pre  => not mbx_mask_is_empty (waited)
+              and then mbx_mask_is_subset (waited, mbx_posted_mask (task_id))
+              and then mbx_are_well_formed
+              and then not mbx_is_empty (task_id),
+      Post => mbx_slot_is_owned (task_id, get_mbx'Result)
+              and then mbx_pool (get_mbx'Result).mbx_entry.sender_id in
+                       os_task_id_param_t
+              and then mbx_pool (get_mbx'Result).sender_tail /=
+                       OS_MBX_INDEX_NONE
+   is
+      urgent    : constant os_mbx_mask_t :=
+        waited and Moth.Config.get_mbx_urgent (task_id);
+      selected  : constant os_mbx_mask_t :=
+        (if mbx_mask_is_empty (urgent) then waited else urgent);
+      head_id   : constant os_mbx_index_t := get_mbx_head (task_id);
+      base      : constant os_mbx_base_t := mbx_fifo (task_id).base;
+      first_id  : os_mbx_index_t := head_id;
+      distance  : os_mbx_seq_t := os_mbx_seq_t'Last;
+   begin
+      if selected /= mbx_posted_mask (task_id) then
+         --  Some posted senders are not selected, so the FIFO head might
+         --  not be a selected mbx. Look for the oldest selected sub-queue
+         --  head. Only the slots of the task are visited.
+         for index in base .. base + Natural (mbx_fifo (task_id).depth) - 1
+         loop
+            pragma Loop_Invariant
+              (mbx_slot_is_owned (task_id, first_id)
+               and then mbx_pool (first_id).mbx_entry.sender_id in
+                        os_task_id_param_t
+               and then mbx_pool (first_id).sender_tail /= OS_MBX_INDEX_NONE);
+
+            declare
+               slot : constant os_mbx_slot_t :=
+                 mbx_pool (os_mbx_index_t (index));
+               age  : constant os_mbx_seq_t :=
+                 slot.seq - mbx_pool (head_id).seq;
+            begin
+               if slot.sender_tail /= OS_MBX_INDEX_NONE
+                 and then slot.mbx_entry.sender_id in os_task_id_param_t
+                 and then mbx_mask_test (selected, slot.mbx_entry.sender_id)
+                 and then age <= distance
+               then
+                  first_id := os_mbx_index_t (index);
+                  distance := age;
+               end if;
+            end;
+         end loop;
+      end if;
+
+      --  Otherwise all posted senders are selected and the oldest mbx is
+      --  the FIFO head.
+      return first_id;
+   end get_mbx;
+
+   ----------------------------
+   -- os_mbx_get_posted_mask --
+   ----------------------------
+
+   function os_mbx_get_posted_mask
+     (task_id : os_task_id_param_t) return os_mbx_mask_t
+   is
+     (mbx_posted_mask (task_id));
+
+   ---------------------------
+   -- os_mbx_get_drop_count --
+   ---------------------------
+
+   function os_mbx_get_drop_count
+     (task_id : os_task_id_param_t) return types.uint32_t
+   is
+     (mbx_dropped (task_id));
+
    --------------------------
-   -- get_mbx_entry_sender --
+   -- os_notify_is_pending --
    --------------------------
 
-   function get_mbx_entry_sender (task_id : os_task_id_param_t;
-                                  index : os_mbx_count_t)
-                                  return os_task_id_param_t
+   function os_notify_is_pending
+     (task_id : os_task_id_param_t) return Boolean
    is
-     (os_task_id_param_t
-        (mbx_fifo (task_id).mbx_array (get_mbx_head (task_id) + index)
-           .sender_id))
+     (notify_word (task_id) /= 0);
+
+   ----------------
+   -- remove_mbx --
+   ----------------
+   --  Remove a mbx from the FIFO of a given task. The mbx has to be the head
+   --  of its sender sub-queue (which is always the case for the mbx returned
+   --  by get_mbx()). No other mbx is moved.
+
+   procedure remove_mbx (task_id : in os_task_id_param_t;
+                         index   : in os_mbx_index_t)
    with
-      Pre => mbx_fifo (task_id).mbx_array (get_mbx_head (task_id) + index)
-        .sender_id in os_task_id_param_t;
+      Pre  => (not mbx_is_empty (task_id)) and then mbx_are_well_formed
+              and then mbx_slot_is_owned (task_id, index)
+              and then mbx_pool (index).mbx_entry
+                         .sender_id in os_task_id_param_t
+              and then mbx_pool (index).sender_tail /= OS_MBX_INDEX_NONE,
+      Post => get_mbx_count (task_id) = get_mbx_count (task_id)'Old - 1
+              and then (not mbx_is_full (task_id)) and then mbx_are_well_formed
+              --  Only the removed slot, its two FIFO neighbours and the next
+              --  mbx from the same sender are relinked.
+              and then (for all other in os_mbx_index_t'Range =>
+                          (if other /= index
+                              and then other /= mbx_pool'Old (index).next
+                              and then other /= mbx_pool'Old (index).prev
+                              and then other /=
+                                       mbx_pool'Old (index).sender_next
+                           then
+                              mbx_pool (other) = mbx_pool'Old (other)))
+              and then (for all other_id in os_task_id_param_t'Range =>
+                          (if other_id /= task_id then
+                              mbx_fifo (other_id) = mbx_fifo'Old (other_id)
+                              and then mbx_posted_mask (other_id) =
+                                       mbx_posted_mask'Old (other_id)))
+   is
+      sender_id : constant os_task_id_param_t :=
+        get_mbx_entry_sender (task_id, index);
+      next_id   : constant os_mbx_link_t :=
+        mbx_pool (index).next;
+      prev_id   : constant os_mbx_link_t :=
+        mbx_pool (index).prev;
+      second_id : constant os_mbx_link_t :=
+        mbx_pool (index).sender_next;
+      position  : constant Natural := mbx_position (index)
+      with
+         Ghost => True;
+      count     : constant Natural := Natural (mbx_fifo (task_id).count)
+      with
+         Ghost => True;
+   begin
+      --  If the FIFO head is removed, the new head is the oldest mbx left,
+      --  so it is the head of its sender sub-queue: an older mbx from the
+      --  same sender would be at position 0, which is the removed mbx.
+      if prev_id = OS_MBX_INDEX_NONE
+        and then next_id /= OS_MBX_INDEX_NONE
+        and then mbx_sender_prev (next_id) /= OS_MBX_INDEX_NONE
+      then
+         lemma_head_of_position (mbx_sender_prev (next_id));
+         pragma Assert (next_id = second_id);
+      end if;
 
-      ----------------------------
-      -- os_mbx_get_posted_mask --
-      ----------------------------
+      --  No other slot links the removed slot: it is a sub-queue head and
+      --  the only one of its sender.
+      pragma Assert (for all other in os_mbx_index_t'Range =>
+                       (if mbx_slot_is_used (other) then
+                           mbx_pool (other).sender_next /= index
+                           and then (if other /= index then
+                                        mbx_pool (other).sender_tail /=
+                                        index)));
+
+      --  Unlink the slot from the FIFO
+      if prev_id = OS_MBX_INDEX_NONE then
+         mbx_fifo (task_id).head := next_id;
+      else
+         mbx_pool (prev_id).next := next_id;
+      end if;
 
-   function os_mbx_get_posted_mask
-     (task_id : os_task_id_param_t) return os_mbx_mask_t
+      if next_id = OS_MBX_INDEX_NONE then
+         mbx_fifo (task_id).tail := prev_id;
+      else
+         mbx_pool (next_id).prev := prev_id;
+      end if;
+
+      --  Unlink the slot from the sender sub-queue
+      if second_id = OS_MBX_INDEX_NONE then
+         --  This was the last mbx from this sender
+         mbx_posted_mask (task_id) :=
+           mbx_mask_clear (mbx_posted_mask (task_id), sender_id);
+      else
+         --  The next mbx from this sender is the new sub-queue head
+         mbx_pool (second_id).sender_tail := mbx_pool (index).sender_tail;
+      end if;
+
+      --  Clear the slot and give it back to the free list
+      mbx_pool (index) :=
+        (mbx_entry   => (sender_id => OS_TASK_ID_NONE, msg => 0),
+         seq         => 0,
+         next        => mbx_fifo (task_id).free,
+         prev        => OS_MBX_INDEX_NONE,
+         sender_next => OS_MBX_INDEX_NONE,
+         sender_tail => OS_MBX_INDEX_NONE);
+
+      mbx_fifo (task_id).free  := index;
+      mbx_fifo (task_id).count :=
+        os_mbx_count_t'Pred (mbx_fifo (task_id).count);
+
+      --  The later mbx of the FIFO move one position closer to the head.
+      --  The freed slot is the new free list head.
+      mbx_position :=
+        [for other in os_mbx_index_t'Range =>
+           (if mbx_owner (other) = task_id
+               and then mbx_slot_is_used (other)
+               and then mbx_position (other) > position
+            then mbx_position (other) - 1
+            else mbx_position (other))];
+      mbx_free_rank (index) := Natural (mbx_fifo (task_id).depth) - count;
+
+      if second_id /= OS_MBX_INDEX_NONE then
+         mbx_sender_prev (second_id) := OS_MBX_INDEX_NONE;
+      end if;
+
+      --  Check the relinked slots first. The other slots keep their links
+      --  and the slots they link keep their back links.
+      pragma Assert (mbx_slot_is_well_formed (index));
+
+      if prev_id /= OS_MBX_INDEX_NONE then
+         pragma Assert (mbx_slot_is_well_formed (prev_id));
+      end if;
+
+      if next_id /= OS_MBX_INDEX_NONE then
+         pragma Assert (mbx_slot_is_well_formed (next_id));
+      end if;
+
+      if second_id /= OS_MBX_INDEX_NONE then
+         pragma Assert (mbx_slot_is_well_formed (second_id));
+      end if;
+
+      pragma Assert (mbx_fifo_is_well_formed (task_id));
+      pragma Assert (for all other in os_mbx_index_t'Range =>
+                       mbx_slot_is_well_formed (other));
+      pragma Assert (mbx_sender_are_well_formed);
+      pragma Assert (mbx_free_are_well_formed);
+   end remove_mbx;
+
+   --------------
+   -- mbx_drop --
+   --------------
+   --  Account for a mbx lost by a given task.
+
+   procedure mbx_drop (task_id : os_task_id_param_t)
    is
-      mbx_mask : os_mbx_mask_t := 0;
    begin
-      if not mbx_is_empty (task_id) then
-         for iterator in
-           os_mbx_count_t'First ..
-             os_mbx_count_t'Pred (get_mbx_count (task_id))
-         loop
-            mbx_mask :=
-              mbx_mask or
-              os_mbx_mask_t
-                (Shift_Left
-                   (Unsigned_32'(1),
-                    Natural (get_mbx_entry_sender (task_id, iterator))));
-         end loop;
+      if mbx_dropped (task_id) /= types.uint32_t'Last then
+         mbx_dropped (task_id) := mbx_dropped (task_id) + 1;
+      end if;
+   end mbx_drop;
+
+   -------------------------
+   -- blocked_sender_push --
+   -------------------------
+   --  Queue a sender blocked on the FIFO of task_id after the others.
+
+   procedure blocked_sender_push (task_id   : os_task_id_param_t;
+                                  sender_id : os_task_id_param_t)
+   is
+      tail_id : constant os_task_id_t := mbx_blocked_tail (task_id);
+   begin
+      mbx_blocked_next (sender_id) := OS_TASK_ID_NONE;
+
+      if tail_id in os_task_id_param_t then
+         mbx_blocked_next (tail_id) := sender_id;
+      else
+         mbx_blocked_head (task_id) := sender_id;
+      end if;
+
+      mbx_blocked_tail (task_id) := sender_id;
+   end blocked_sender_push;
+
+   ------------------------
+   -- blocked_sender_pop --
+   ------------------------
+   --  Take the sender blocked for the longest time on the FIFO of task_id
+   --  (OS_TASK_ID_NONE if there is none).
+
+   procedure blocked_sender_pop (task_id   : os_task_id_param_t;
+                                 sender_id : out os_task_id_t)
+   is
+   begin
+      sender_id := mbx_blocked_head (task_id);
+
+      if sender_id in os_task_id_param_t then
+         mbx_blocked_head (task_id) := mbx_blocked_next (sender_id);
+         mbx_blocked_next (sender_id) := OS_TASK_ID_NONE;
+
+         if mbx_blocked_head (task_id) = OS_TASK_ID_NONE then
+            mbx_blocked_tail (task_id) := OS_TASK_ID_NONE;
+         end if;
+      end if;
+   end blocked_sender_pop;
+
+   --------------------------
+   -- wake_blocked_senders --
+   --------------------------
+   --  Slots were freed in the FIFO of task_id. Give them to the senders
+   --  blocked on this FIFO in arrival order and make these senders ready
+   --  again.
+
+   procedure wake_blocked_senders (task_id : in os_task_id_param_t)
+   with
+      Pre  => mbx_are_well_formed
+              and then Moth.os_ghost_task_list_is_well_formed,
+      Post => mbx_are_well_formed
+              and then Moth.os_ghost_task_list_is_well_formed
+   is
+      sender_id : os_task_id_t;
+   begin
+      --  A sender is queued once at most, so there are no more rounds
+      --  than tasks.
+      for round in os_task_id_param_t loop
+         pragma Loop_Invariant (mbx_are_well_formed
+                                and Moth.os_ghost_task_list_is_well_formed);
+
+         exit when mbx_is_full (task_id);
+
+         blocked_sender_pop (task_id, sender_id);
+
+         exit when sender_id not in os_task_id_param_t;
+
+         mbx_add_message (task_id, sender_id, mbx_blocked_msg (sender_id));
+         mbx_blocked_msg (sender_id)    := 0;
+         mbx_blocked_status (sender_id) := OS_SUCCESS;
+         Moth.Scheduler.wake_mbx (sender_id);
+
+         if mbx_mask_test (Moth.Scheduler.get_mbx_mask (task_id), sender_id)
+         then
+            Moth.Scheduler.wake_mbx (task_id);
+         end if;
+      end loop;
+   end wake_blocked_senders;
+
+   ------------------
+   -- mbx_overflow --
+   ------------------
+   --  Apply the overflow policy of a task whose FIFO is full. room tells
+   --  if a slot was freed for the new mbx (drop oldest). Otherwise the new
+   --  mbx was merged (status is OS_SUCCESS), dropped (OS_ERROR_DROPPED) or
+   --  rejected (OS_ERROR_FIFO_FULL).
+
+   procedure mbx_overflow (status  : out os_status_t;
+                           room    : out Boolean;
+                           dest_id : in os_task_id_param_t;
+                           src_id  : in os_task_id_param_t;
+                           mbx_msg : in os_mbx_msg_t)
+   with
+      Pre  => mbx_is_full (dest_id) and then mbx_are_well_formed
+              and then Moth.os_ghost_task_list_is_well_formed,
+      Post => mbx_are_well_formed
+              and then Moth.os_ghost_task_list_is_well_formed
+              and then (if room then not mbx_is_full (dest_id))
+   is
+      first_id : constant os_mbx_link_t := mbx_sender_head (dest_id, src_id);
+   begin
+      room   := False;
+      status := OS_ERROR_FIFO_FULL;
+
+      case Moth.Config.get_mbx_overflow (dest_id) is
+         when Moth.Config.OS_MBX_OVERFLOW_DROP_OLDEST =>
+            if not mbx_is_empty (dest_id) then
+               --  The FIFO head is the oldest mbx of its sender too
+               --  (invariant 3).
+               remove_mbx (dest_id, get_mbx_head (dest_id));
+               mbx_drop (dest_id);
+
+               --  The senders blocked on this FIFO were there first
+               wake_blocked_senders (dest_id);
+
+               if mbx_is_full (dest_id) and then not mbx_is_empty (dest_id)
+               then
+                  remove_mbx (dest_id, get_mbx_head (dest_id));
+                  mbx_drop (dest_id);
+               end if;
+
+               room   := not mbx_is_full (dest_id);
+               status := (if room then OS_SUCCESS else OS_ERROR_FIFO_FULL);
+            end if;
+
+         when Moth.Config.OS_MBX_OVERFLOW_DROP_NEWEST =>
+            --  The sender is told that its mbx is lost
+            mbx_drop (dest_id);
+            status := OS_ERROR_DROPPED;
+
+         when Moth.Config.OS_MBX_OVERFLOW_COALESCE =>
+            if first_id /= OS_MBX_INDEX_NONE then
+               --  The latest mbx from this sender is replaced in place.
+               mbx_pool (mbx_pool (first_id).sender_tail).mbx_entry.msg :=
+                 mbx_msg;
+               mbx_drop (dest_id);
+               status := OS_SUCCESS;
+            end if;
+
+         when others =>
+            null;
+      end case;
+   end mbx_overflow;
+
+   --------------------
+   -- send_permitted --
+   --------------------
+   --  Post a mbx to a task that accepts mbx from the sender (permission is
+   --  already checked) and wake it up if it is waiting for it. If the task
+   --  FIFO is full, its overflow policy is applied.
+
+   procedure send_permitted (status  : out os_status_t;
+                             dest_id : in os_task_id_param_t;
+                             src_id  : in os_task_id_param_t;
+                             mbx_msg : in os_mbx_msg_t)
+   with
+      Pre  => Moth.os_ghost_task_list_is_well_formed and mbx_are_well_formed,
+      Post => Moth.os_ghost_task_list_is_well_formed and mbx_are_well_formed
+   is
+      room : Boolean := not mbx_is_full (dest_id);
+   begin
+      status := OS_SUCCESS;
+
+      if not room then
+         --  The overflow policy of the task might make room for the mbx
+         mbx_overflow (status, room, dest_id, src_id, mbx_msg);
       end if;
 
-      return mbx_mask;
-   end os_mbx_get_posted_mask;
+      if room then
+         mbx_add_message (dest_id, src_id, mbx_msg);
+         if mbx_mask_test (Moth.Scheduler.get_mbx_mask (dest_id), src_id) then
+            Moth.Scheduler.wake_mbx (dest_id);
+         end if;
+      end if;
+   end send_permitted;
 
    -------------------
    -- send_one_task --
@@ -208,25 +1153,9 @@ is
    is
       current : constant os_task_id_param_t :=
         Moth.Scheduler.get_current_task_id;
-      mbx_permission : constant os_mbx_mask_t :=
-        Moth.Config.get_mbx_permission (dest_id) and
-        os_mbx_mask_t (Shift_Left (Unsigned_32'(1), Natural (current)));
    begin
-      if mbx_permission /= 0 then
-         if mbx_is_full (dest_id) then
-            status := OS_ERROR_FIFO_FULL;
-         else
-            mbx_add_message (dest_id, current, mbx_msg);
-            if
-              (Moth.Scheduler.get_mbx_mask (dest_id) and
-               os_mbx_mask_t
-                 (Shift_Left (Unsigned_32'(1), Natural (current)))) /=
-              0
-            then
-               Moth.Scheduler.add_task_to_ready_list (dest_id);
-            end if;
-            status := OS_SUCCESS;
-         end if;
+      if mbx_mask_test (Moth.Config.get_mbx_permission (dest_id), current) then
+         send_permitted (status, dest_id, current, mbx_msg);
       else
          status := OS_ERROR_DENIED;
       end if;
@@ -243,17 +1172,37 @@ is
       Pre  => Moth.os_ghost_task_list_is_well_formed and mbx_are_well_formed,
       Post => Moth.os_ghost_task_list_is_well_formed and mbx_are_well_formed
    is
-      ret : os_status_t;
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+      dest_id : os_task_id_t;
+      ret     : os_status_t;
    begin
       status := OS_ERROR_DENIED;
 
-      for iterator in os_task_id_param_t'Range loop
-         send_one_task (ret, iterator, mbx_msg);
+      --  Only the tasks accepting mbx from the current task are visited.
+      --  They are listed by decreasing priority at build time, so they are
+      --  also woken up in priority order.
+      for index in 1 .. Moth.Config.get_receiver_count (current) loop
+         dest_id :=
+           Moth.Config.get_receiver (current, os_task_id_param_t (index - 1));
+
+         if dest_id in os_task_id_param_t then
+            send_permitted (ret, dest_id, current, mbx_msg);
+         else
+            ret := OS_ERROR_DENIED;
+         end if;
 
+         --  A lost mbx is reported first: a full FIFO, then a dropped mbx
          if ret = OS_ERROR_FIFO_FULL then
             status := ret;
-         else
+         elsif ret = OS_ERROR_DROPPED then
             if status /= OS_ERROR_FIFO_FULL then
+               status := ret;
+            end if;
+         else
+            if status /= OS_ERROR_FIFO_FULL
+              and then status /= OS_ERROR_DROPPED
+            then
                if ret = OS_SUCCESS then
                   status := OS_SUCCESS;
                end if;
@@ -262,155 +1211,26 @@ is
       end loop;
    end send_all_task;
 
-   -------------------
-   -- get_mbx_entry --
-   -------------------
-
-   function get_mbx_entry (task_id : os_task_id_param_t;
-                           index   : os_mbx_count_t) return os_mbx_entry_t
-   is
-     (mbx_fifo (task_id).mbx_array (get_mbx_head (task_id) + index));
-
-   --------------------------
-   -- is_waiting_mbx_entry --
-   --------------------------
-
-   function is_waiting_mbx_entry (task_id : os_task_id_param_t;
-                                  index   : os_mbx_count_t) return Boolean
-   is
-     ((Moth.Scheduler.get_mbx_mask (task_id) and
-       os_mbx_mask_t
-         (Shift_Left
-            (Unsigned_32'(1),
-             Natural (get_mbx_entry_sender (task_id, index))))) /= 0)
-   with
-      Pre => (not mbx_is_empty (task_id)) and then
-              mbx_are_well_formed and then
-              index < get_mbx_count (task_id) and then
-              get_mbx_entry_sender (task_id, index) in os_task_id_param_t;
-
-      ----------------------
-      --  Ghost functions --
-      ----------------------
-
-      -------------------------
-      -- mbx_are_well_formed --
-      -------------------------
-
-   function mbx_are_well_formed return Boolean is
-     (for all task_id in os_task_id_param_t'Range =>
-        (for all index in os_mbx_index_t'Range =>
-           (if (get_mbx_count (task_id) = 0) then
-              (mbx_fifo (task_id).mbx_array (index).sender_id =
-               OS_TASK_ID_NONE)
-            elsif (get_mbx_count (task_id) = os_mbx_count_t'Last) then
-              (mbx_fifo (task_id).mbx_array (index).sender_id in
-                 os_task_id_param_t)
-            elsif
-              (get_mbx_head (task_id) <=
-               (get_mbx_head (task_id) +
-                os_mbx_count_t'Pred (get_mbx_count (task_id))))
-            then
-              (if
-                 (index >= get_mbx_head (task_id) and
-                  index <=
-                    (get_mbx_head (task_id) +
-                     os_mbx_count_t'Pred (get_mbx_count (task_id))))
-               then
-                 (mbx_fifo (task_id).mbx_array (index).sender_id in
-                    os_task_id_param_t)
-               else
-                 (mbx_fifo (task_id).mbx_array (index).sender_id =
-                  OS_TASK_ID_NONE))
-            elsif
-              (index < get_mbx_head (task_id) and
-               index >= (get_mbx_head (task_id) + get_mbx_count (task_id)))
-            then
-              (mbx_fifo (task_id).mbx_array (index).sender_id =
-               OS_TASK_ID_NONE)
-            else
-              (mbx_fifo (task_id).mbx_array (index).sender_id in
-                 os_task_id_param_t))));
-
    ----------------
    -- Public API --
    ----------------
 
-   ----------------------
-   -- remove_first_mbx --
-   ----------------------
+   -----------
+   -- query --
+   -----------
 
-   procedure remove_first_mbx (task_id : in os_task_id_param_t)
-   with
-      Pre  => (not mbx_is_empty (task_id)) and then mbx_are_well_formed,
-      Post => (mbx_fifo = (mbx_fifo'Old with delta
-         task_id => (mbx_fifo'Old(task_id) with delta
-               count     => os_mbx_count_t'Pred (mbx_fifo'Old (task_id).count),
-               head      => os_mbx_index_t'Succ (mbx_fifo'Old (task_id).head),
-               mbx_array => (mbx_fifo'Old(task_id).mbx_array with delta
-                   mbx_fifo'Old(task_id).head =>
-                      (sender_id => OS_TASK_ID_NONE, msg => 0))))) and then
-      (not mbx_is_full (task_id)) and then mbx_are_well_formed
-   is
-      mbx_index : constant os_mbx_index_t := get_mbx_head (task_id);
-   begin
-      mbx_fifo (task_id).count :=
-        os_mbx_count_t'Pred (mbx_fifo (task_id).count);
-      mbx_fifo (task_id).head := os_mbx_index_t'Succ (mbx_fifo (task_id).head);
-      mbx_fifo (task_id).mbx_array (mbx_index).sender_id := OS_TASK_ID_NONE;
-      mbx_fifo (task_id).mbx_array (mbx_index).msg       := 0;
-   end remove_first_mbx;
-
-   ---------------------
-   -- remove_last_mbx --
-   ---------------------
-
-   procedure remove_last_mbx (task_id : in os_task_id_param_t)
-   with
-      Pre  => (not mbx_is_empty (task_id)) and mbx_are_well_formed,
-      Post => (mbx_fifo = (mbx_fifo'Old with delta
-         task_id => (mbx_fifo'Old(task_id) with delta
-               count     => os_mbx_count_t'Pred (mbx_fifo'Old(task_id).count),
-               head      => mbx_fifo'Old(task_id).head,
-               mbx_array => (mbx_fifo'Old(task_id).mbx_array with delta
-                   mbx_fifo(task_id).head + mbx_fifo(task_id).count =>
-                      (sender_id => OS_TASK_ID_NONE, msg => 0))))) and then
-      mbx_are_well_formed
-   is
-      mbx_index : constant os_mbx_index_t := get_mbx_tail (task_id);
-   begin
-      mbx_fifo (task_id).count :=
-        os_mbx_count_t'Pred (mbx_fifo (task_id).count);
-      mbx_fifo (task_id).mbx_array (mbx_index).sender_id := OS_TASK_ID_NONE;
-      mbx_fifo (task_id).mbx_array (mbx_index).msg       := 0;
-   end remove_last_mbx;
-
-   --------------------
-   -- mbx_shift_down --
-   --------------------
-
-   procedure mbx_shift_down (task_id : in os_task_id_param_t;
-                             index   : in os_mbx_count_t)
-   with
-      Pre => (not mbx_is_empty (task_id)) and mbx_are_well_formed and
-      (index > os_mbx_count_t'First) and
-      (index < os_mbx_count_t'Pred (get_mbx_count (task_id))),
-      Post => mbx_are_well_formed and
-      mbx_fifo (task_id).count = mbx_fifo'Old (task_id).count and
-      mbx_fifo (task_id).head = mbx_fifo'Old (task_id).head
-   is
-      mbx_index : os_mbx_index_t;
+   procedure query (mbx_query : out os_mbx_query_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
    begin
-      for iterator in index .. os_mbx_count_t'Pred (get_mbx_count (task_id))
-      loop
-         pragma Loop_Invariant (mbx_are_well_formed);
-
-         mbx_index := get_mbx_head (task_id) + iterator;
-
-         mbx_fifo (task_id).mbx_array (mbx_index) :=
-           mbx_fifo (task_id).mbx_array (os_mbx_index_t'Succ (mbx_index));
-      end loop;
-   end mbx_shift_down;
+      mbx_query :=
+        (count       => types.uint32_t (get_mbx_count (current)),
+         free        => types.uint32_t (mbx_fifo (current).depth -
+                                        get_mbx_count (current)),
+         dropped     => mbx_dropped (current),
+         posted_mask => mbx_posted_mask (current));
+   end query;
 
    -------------
    -- receive --
@@ -422,6 +1242,10 @@ is
       --  retrieve current task id
       current : constant os_task_id_param_t :=
         Moth.Scheduler.get_current_task_id;
+
+      --  senders we are waiting for that have posted a mbx
+      waited  : constant os_mbx_mask_t :=
+        Moth.Scheduler.get_mbx_mask (current) and mbx_posted_mask (current);
    begin
 
       mbx_entry.sender_id := OS_TASK_ID_NONE;
@@ -430,68 +1254,68 @@ is
       if mbx_is_empty (current) then
          --  mbx queue is empty, so we return with error
          status := OS_ERROR_FIFO_EMPTY;
-      else
-         --  initialize status to error in case we don't find a mbx.
+      elsif mbx_mask_is_empty (waited) then
+         --  None of the mbx comes from a task we are waiting for.
          status := OS_ERROR_RECEIVE;
+      else
+         declare
+            index : constant os_mbx_index_t := get_mbx (current, waited);
+         begin
+            --  copy the mbx into the task mbx entry
+            mbx_entry := get_mbx_entry (current, index);
 
-         --  go through received mbx for the current task
-         for iterator in
-           os_mbx_count_t'First ..
-             os_mbx_count_t'Pred (get_mbx_count (current))
-         loop
-
-            pragma Loop_Invariant (mbx_are_well_formed);
-            pragma Loop_Invariant (not mbx_is_empty (current));
-
-            --  This Loop Invariant is a work arround. The prover is unable
-            --  to see that the code under the os_mbx_is_waiting_mbx_entry()
-            --  branch has no impact on the loop as the branch exits
-            --  unconditionnaly in all cases. This loop invariant allows the
-            --  prover to work but it should be removed later when the prover
-            --  supports branches with exit path.
-            pragma Loop_Invariant (mbx_fifo = mbx_fifo'Loop_Entry);
+            --  and remove it from the mbx queue without moving the others.
+            remove_mbx (current, index);
+         end;
 
-            pragma Assert
-              (get_mbx_entry_sender (current, iterator) in os_task_id_param_t);
+         --  The freed slot might be waited for by a blocked sender
+         wake_blocked_senders (current);
 
-            --  is this a mbx we are waiting for
-            if is_waiting_mbx_entry (current, iterator) then
+         --  We found a matching mbx
+         status := OS_SUCCESS;
+      end if;
+   end receive;
 
-               --  copy the mbx into the task mbx entry
-               mbx_entry := get_mbx_entry (current, iterator);
+   -------------------
+   -- receive_batch --
+   -------------------
 
-               if iterator = os_mbx_count_t'First then
-                  --  This was the first mbx (aka mbx head )
+   procedure receive_batch (status    : out os_status_t;
+                            received  : out types.uint32_t;
+                            mbx_count : in types.uint32_t;
+                            mbx_batch : in out os_mbx_entry_batch_t)
+   is
+      ret : os_status_t;
+   begin
+      received := 0;
 
-                  --  Clear the first entry and increment the mbx head
-                  remove_first_mbx (current);
-               else
-                  --  This was not the first MBX
+      if mbx_count = 0 or mbx_count > OS_MBX_BATCH_MAX then
+         status := OS_ERROR_PARAM;
+      else
+         status := OS_SUCCESS;
 
-                  --  Compact the mbx if necessary
-                  if iterator < os_mbx_count_t'Pred (get_mbx_count (current))
-                  then
-                     --  This is not the last MBX
-                     --  For now we "compact" the rest of the mbx queue, so
-                     --  that there is no "hole" in it for the next mbx search.
+         for index in os_mbx_batch_index_t'First ..
+                      os_mbx_batch_index_t (mbx_count - 1)
+         loop
+            pragma Loop_Invariant (received = types.uint32_t (index)
+                                   and mbx_are_well_formed
+                                   and Moth.os_ghost_task_list_is_well_formed);
 
-                     mbx_shift_down (current, iterator);
-                  end if;
+            receive (ret, mbx_batch (index));
 
-                  --  remove the last mbx from the mbx queue (by clearing the
-                  --  last entry and decreasing the mbx count).
-                  remove_last_mbx (current);
+            if ret /= OS_SUCCESS then
+               --  This is an error only if we did not get any mbx
+               if received = 0 then
+                  status := ret;
                end if;
 
-               --  We found a matching mbx
-               status := OS_SUCCESS;
-
-               --  Exit the for loop as we found a mbx we were waiting for.
                exit;
             end if;
+
+            received := received + 1;
          end loop;
       end if;
-   end receive;
+   end receive_batch;
 
    ----------
    -- send --
@@ -513,19 +1337,357 @@ is
       end if;
    end send;
 
+   ---------------
+   -- send_wait --
+   ---------------
+
+   procedure send_wait (status  : out os_status_t;
+                        task_id : out os_task_id_param_t;
+                        dest_id : in types.int8_t;
+                        mbx_msg : in os_mbx_msg_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+   begin
+      task_id := current;
+
+      --  dest_id comes from user space. Only one other task can be waited
+      --  for (a broadcast cannot be blocked on several FIFOs).
+      if dest_id not in os_task_id_param_t or else dest_id = current then
+         status := OS_ERROR_PARAM;
+      else
+         send_one_task (status, dest_id, mbx_msg);
+
+         --  Block only if a slot can be freed later (the FIFO is not empty
+         --  and its owner did not exit for good).
+         if status = OS_ERROR_FIFO_FULL and then not mbx_is_empty (dest_id)
+           and then not mbx_closed (dest_id)
+         then
+            blocked_sender_push (dest_id, current);
+            mbx_blocked_msg (current)    := mbx_msg;
+            mbx_blocked_status (current) := OS_SUCCESS;
+
+            --  The final status is set when the sender is woken up
+            status := OS_SUCCESS;
+            Moth.Scheduler.wait_send (task_id);
+         end if;
+      end if;
+   end send_wait;
+
+   ----------------------
+   -- send_wait_status --
+   ----------------------
+
+   procedure send_wait_status (status : out os_status_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+   begin
+      status := mbx_blocked_status (current);
+      mbx_blocked_status (current) := OS_SUCCESS;
+   end send_wait_status;
+
+   -----------
+   -- close --
+   -----------
+
+   procedure close (task_id : in os_task_id_param_t)
+   is
+      sender_id : os_task_id_t;
+   begin
+      mbx_closed (task_id) := True;
+
+      --  A sender is queued once at most, so there are no more rounds
+      --  than tasks.
+      for round in os_task_id_param_t loop
+         pragma Loop_Invariant (Moth.os_ghost_task_list_is_well_formed);
+
+         blocked_sender_pop (task_id, sender_id);
+
+         exit when sender_id not in os_task_id_param_t;
+
+         --  The mbx will never be received
+         mbx_blocked_msg (sender_id)    := 0;
+         mbx_blocked_status (sender_id) := OS_ERROR_DENIED;
+         Moth.Scheduler.wake_mbx (sender_id);
+      end loop;
+   end close;
+
+   ----------------
+   -- send_batch --
+   ----------------
+
+   procedure send_batch (status       : out os_status_t;
+                         mbx_count    : in types.uint32_t;
+                         mbx_batch    : in os_mbx_send_batch_t;
+                         status_batch : in out os_status_batch_t)
+   is
+      ret : os_status_t;
+   begin
+      if mbx_count = 0 or mbx_count > OS_MBX_BATCH_MAX then
+         status := OS_ERROR_PARAM;
+      else
+         status := OS_SUCCESS;
+
+         for index in os_mbx_batch_index_t'First ..
+                      os_mbx_batch_index_t (mbx_count - 1)
+         loop
+            pragma Loop_Invariant (mbx_are_well_formed
+                                   and Moth.os_ghost_task_list_is_well_formed);
+
+            send (ret, mbx_batch (index).dest_id, mbx_batch (index).msg);
+
+            status_batch (index) := ret;
+
+            --  Report the first failed send
+            if status = OS_SUCCESS then
+               status := ret;
+            end if;
+         end loop;
+      end if;
+   end send_batch;
+
+   ------------
+   -- notify --
+   ------------
+
+   procedure notify (status  : out os_status_t;
+                     dest_id : in types.int8_t;
+                     bits    : in os_notify_word_t)
+   is
+   --  dest_id comes from uncontroled C calls (user space) We don't make
+   --  assumptions on its value, so we are testing all cases.
+   begin
+      if dest_id not in os_task_id_param_t or else bits = 0 then
+         status := OS_ERROR_PARAM;
+      elsif not mbx_mask_test (Moth.Config.get_mbx_permission (dest_id),
+                               Moth.Scheduler.get_current_task_id)
+      then
+         status := OS_ERROR_DENIED;
+      else
+         notify_word (dest_id) := notify_word (dest_id) or bits;
+         Moth.Scheduler.wake_notified (dest_id);
+         status := OS_SUCCESS;
+      end if;
+   end notify;
+
+   -----------------
+   -- notify_take --
+   -----------------
+
+   procedure notify_take (bits : out os_notify_word_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+   begin
+      bits := notify_word (current);
+      notify_word (current) := 0;
+   end notify_take;
+
+   ---------------
+   -- irq_route --
+   ---------------
+
+   procedure irq_route
+   is
+      irq_lines : types.uint32_t;
+      irq_bit   : os_notify_word_t;
+      owner     : os_task_id_t;
+   begin
+      os_arch.interrupt_take (irq_lines);
+
+      for irq in os_irq_t loop
+         pragma Loop_Invariant (Moth.os_ghost_task_list_is_well_formed);
+
+         irq_bit := Shift_Left (Unsigned_32'(1), irq);
+
+         if (irq_lines and irq_bit) /= 0 then
+            owner := Moth.Config.get_irq_owner (irq);
+
+            if owner in os_task_id_param_t then
+               notify_word (owner) := notify_word (owner) or irq_bit;
+               Moth.Scheduler.wake_notified (owner);
+            end if;
+         end if;
+      end loop;
+   end irq_route;
+
+   -------------
+   -- irq_ack --
+   -------------
+
+   procedure irq_ack (status : out os_status_t;
+                      irq    : in types.uint32_t)
+   is
+   --  irq comes from user space. Only the owner can unmask its line.
+   begin
+      if irq >= OS_IRQ_MAX then
+         status := OS_ERROR_PARAM;
+      elsif Moth.Config.get_irq_owner (os_irq_t (irq)) /=
+            Moth.Scheduler.get_current_task_id
+      then
+         status := OS_ERROR_DENIED;
+      else
+         os_arch.interrupt_unmask (os_irq_t (irq));
+         status := OS_SUCCESS;
+      end if;
+   end irq_ack;
+
+   ----------
+   -- call --
+   ----------
+
+   procedure call (status  : out os_status_t;
+                   task_id : out os_task_id_param_t;
+                   dest_id : in types.int8_t;
+                   mbx_msg : in os_mbx_msg_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+   begin
+      task_id := current;
+
+      --  dest_id comes from user space. Only one other task can be called.
+      if dest_id not in os_task_id_param_t or else dest_id = current then
+         status := OS_ERROR_PARAM;
+      else
+         send_one_task (status, dest_id, mbx_msg);
+
+         if status = OS_SUCCESS then
+            --  Wait for the answer of the called task only.
+            Moth.Scheduler.wait_direct (task_id, mbx_mask_single (dest_id),
+                                        dest_id);
+         end if;
+      end if;
+   end call;
+
+   ----------------
+   -- reply_wait --
+   ----------------
+
+   procedure reply_wait (status       : out os_status_t;
+                         task_id      : out os_task_id_param_t;
+                         dest_id      : in types.int8_t;
+                         mbx_msg      : in os_mbx_msg_t;
+                         waiting_mask : in os_mbx_mask_t)
+   is
+      current : constant os_task_id_param_t :=
+        Moth.Scheduler.get_current_task_id;
+   begin
+      task_id := current;
+
+      if dest_id = OS_TASK_ID_NONE then
+         --  No answer to send (first request), just wait.
+         status := OS_SUCCESS;
+         Moth.Scheduler.wait (task_id, waiting_mask);
+      elsif dest_id not in os_task_id_param_t or else dest_id = current then
+         status := OS_ERROR_PARAM;
+      else
+         send_one_task (status, dest_id, mbx_msg);
+
+         if status = OS_SUCCESS then
+            --  Wait for the next request.
+            Moth.Scheduler.wait_direct (task_id, waiting_mask, dest_id);
+         end if;
+      end if;
+   end reply_wait;
+
    ----------
    -- init --
    ----------
 
    procedure init is
+      base  : Natural := 0;
+      depth : Natural;
    begin
-      mbx_fifo :=
-        [others =>
-           (head      => os_mbx_index_t'First,
-            count     => os_mbx_count_t'First,
-            mbx_array => [others =>
-                            (sender_id => OS_TASK_ID_NONE,
-                             msg       => 0)])];
+      mbx_pool := [others => (mbx_entry   => (sender_id => OS_TASK_ID_NONE,
+                                              msg       => 0),
+                              seq         => 0,
+                              next        => OS_MBX_INDEX_NONE,
+                              prev        => OS_MBX_INDEX_NONE,
+                              sender_next => OS_MBX_INDEX_NONE,
+                              sender_tail => OS_MBX_INDEX_NONE)];
+      mbx_fifo := [others => (head  => OS_MBX_INDEX_NONE,
+                              tail  => OS_MBX_INDEX_NONE,
+                              free  => OS_MBX_INDEX_NONE,
+                              count => os_mbx_count_t'First,
+                              depth => os_mbx_count_t'First,
+                              base  => 0,
+                              seq   => 0)];
+      mbx_posted_mask := [others => OS_MBX_MASK_NONE];
+
+      mbx_owner       := [others => OS_TASK_ID_NONE];
+      mbx_position    := [others => 0];
+      mbx_free_rank   := [others => 0];
+      mbx_sender_prev := [others => OS_MBX_INDEX_NONE];
+
+      for task_id in os_task_id_param_t'Range loop
+         pragma Loop_Invariant
+           (base <= OS_MBX_POOL_CNT
+            and then (for all index in os_mbx_index_t'Range =>
+                        (if Natural (index) >= base then
+                            mbx_owner (index) = OS_TASK_ID_NONE
+                            and then mbx_pool (index).next =
+                                     OS_MBX_INDEX_NONE))
+            and then (for all other_id in task_id .. os_task_id_param_t'Last =>
+                        mbx_fifo (other_id).depth = os_mbx_count_t'First
+                        and then mbx_fifo (other_id).base = 0)
+            and then mbx_are_well_formed);
+
+         depth := Natural (Moth.Config.get_mbx_count (task_id));
+
+         --  The sum of all task depths is checked against the pool size at
+         --  build time (see task_config.xsl).
+         pragma Assume (base + depth <= OS_MBX_POOL_CNT);
+
+         mbx_fifo (task_id).head  := OS_MBX_INDEX_NONE;
+         mbx_fifo (task_id).tail  := OS_MBX_INDEX_NONE;
+         mbx_fifo (task_id).count := os_mbx_count_t'First;
+         mbx_fifo (task_id).depth := os_mbx_count_t (depth);
+         mbx_fifo (task_id).base  := base;
+         mbx_fifo (task_id).seq   := 0;
+
+         --  All the task slots are chained in its free list
+         if depth = 0 then
+            mbx_fifo (task_id).free := OS_MBX_INDEX_NONE;
+         else
+            mbx_fifo (task_id).free := os_mbx_index_t (base);
+
+            for index in base .. base + depth - 2 loop
+               pragma Loop_Invariant
+                 (for all other in os_mbx_index_t'Range =>
+                    (if Natural (other) in base .. index - 1 then
+                        mbx_pool (other).next = other + 1
+                     else
+                        mbx_pool (other) = mbx_pool'Loop_Entry (other)));
+
+               mbx_pool (os_mbx_index_t (index)).next :=
+                 os_mbx_index_t (index + 1);
+            end loop;
+         end if;
+
+         --  The slots of the task are ranked from the end of its free list
+         mbx_owner :=
+           [for index in os_mbx_index_t'Range =>
+              (if Natural (index) in base .. base + depth - 1 then task_id
+               else mbx_owner (index))];
+         mbx_free_rank :=
+           [for index in os_mbx_index_t'Range =>
+              (if Natural (index) in base .. base + depth - 1
+               then base + depth - 1 - Natural (index)
+               else mbx_free_rank (index))];
+
+         base := base + depth;
+      end loop;
+
+      mbx_dropped        := [others => 0];
+      mbx_blocked_head   := [others => OS_TASK_ID_NONE];
+      mbx_blocked_tail   := [others => OS_TASK_ID_NONE];
+      mbx_blocked_next   := [others => OS_TASK_ID_NONE];
+      mbx_blocked_msg    := [others => 0];
+      mbx_blocked_status := [others => OS_SUCCESS];
+      mbx_closed         := [others => False];
+      notify_word        := [others => 0];
    end init;
 
 end Mailbox;
@@ -35,10 +35,14 @@ package body Scheduler with
    Refined_State => (Scheduler_State => (ready_task,
                                          next_task,
                                          prev_task,
-                                         task_list_head,
+                                         prio_head,
+                                         ready_prio_word,
+                                         ready_prio_group,
                                          mbx_mask,
+                                         notify_waiting,
                                          task_priority,
-                                         current_task))
+                                         current_task,
+                                         task_rank))
 is
 
    OS_INTERRUPT_TASK_ID : constant := 0;
@@ -47,6 +51,26 @@ is
    -- Private API --
    -----------------
 
+   -------------------
+   -- Private types --
+   -------------------
+
+   subtype os_priority_t is Moth.Config.os_priority_t;
+
+   --  The ready priority bitmap is split in groups of 32 priority levels.
+   --  One bit per group in ready_prio_group tells if the group has at least
+   --  one ready priority level.
+   OS_PRIORITY_PER_GROUP : constant := 32;
+   OS_PRIORITY_GROUP_CNT : constant :=
+     (os_priority_t'Modulus + OS_PRIORITY_PER_GROUP - 1) /
+     OS_PRIORITY_PER_GROUP;
+
+   subtype os_priority_group_t is Natural range 0 .. OS_PRIORITY_GROUP_CNT - 1;
+
+   subtype os_bit_index_t is Natural range 0 .. 31;
+
+   type os_task_ready_t is array (os_task_id_param_t) of Boolean;
+
    -----------------------
    -- Private variables --
    -----------------------
@@ -55,28 +79,45 @@ is
    -- ready_task --
    -----------------------
 
-   ready_task : array (os_task_id_param_t) of Boolean;
+   ready_task : os_task_ready_t;
 
    -----------------------
    -- next_task --
    -----------------------
+   --  Next task in the circular FIFO of the task priority level.
 
    next_task : array (os_task_id_param_t) of os_task_id_t;
 
    -----------------------
    -- prev_task --
    -----------------------
+   --  Previous task in the circular FIFO of the task priority level.
 
    prev_task : array (os_task_id_param_t) of os_task_id_t;
 
-   -----------------------------
-   -- task_list_head --
-   -----------------------------
-   --  This variable holds the ID of the first task in the ready list (the next
-   --  one that will be elected).
-   --  Note: Its value could be OS_TASK_ID_NONE if no task is ready.
+   ---------------
+   -- prio_head --
+   ---------------
+   --  For each priority level, this variable holds the ID of the first ready
+   --  task (the next one that will be elected at this level). The last one is
+   --  prev_task (prio_head (priority)).
+   --  Note: Its value is OS_TASK_ID_NONE if no task is ready at this level.
+
+   prio_head : array (os_priority_t) of os_task_id_t;
+
+   ---------------------
+   -- ready_prio_word --
+   ---------------------
+   --  One bit per priority level with at least one ready task.
+
+   ready_prio_word : array (os_priority_group_t) of Unsigned_32;
+
+   ----------------------
+   -- ready_prio_group --
+   ----------------------
+   --  One bit per ready_prio_word that is not 0.
 
-   task_list_head : os_task_id_t;
+   ready_prio_group : Unsigned_32;
 
    --------------
    -- mbx_mask --
@@ -84,6 +125,13 @@ is
 
    mbx_mask : array (os_task_id_param_t) of os_mbx_mask_t;
 
+   --------------------
+   -- notify_waiting --
+   --------------------
+   --  Tasks that left the ready list to wait for a notification.
+
+   notify_waiting : array (os_task_id_param_t) of Boolean;
+
    ------------------
    -- current_task --
    ------------------
@@ -94,7 +142,101 @@ is
    -- task_priority   --
    ---------------------
 
-   task_priority : array (os_task_id_param_t) of Moth.Config.os_priority_t;
+   task_priority : array (os_task_id_param_t) of os_priority_t;
+
+   ---------------------
+   -- Ghost variables --
+   ---------------------
+   --  They are only used by the provers to track the ready FIFOs.
+
+   ---------------
+   -- task_rank --
+   ---------------
+   --  For each ready task, its distance from the head of the FIFO of its
+   --  priority level (0 for the head).
+
+   task_rank : array (os_task_id_param_t) of Natural
+   with
+      Ghost => True;
+
+   ----------------------------------
+   -- Private functions/procedures --
+   ----------------------------------
+
+   -----------------
+   -- highest_bit --
+   -----------------
+   --  Find the index of the most significant bit set in a word in constant
+   --  time (binary search on the word).
+
+   function highest_bit (value : Unsigned_32) return os_bit_index_t
+   with
+      Pre  => value /= 0,
+      Post => Shift_Right (value, highest_bit'Result) = 1
+   is
+      word  : Unsigned_32    := value;
+      index : os_bit_index_t := 0;
+   begin
+      if word > 16#ffff# then
+         word  := Shift_Right (word, 16);
+         index := index + 16;
+      end if;
+
+      if word > 16#ff# then
+         word  := Shift_Right (word, 8);
+         index := index + 8;
+      end if;
+
+      if word > 16#f# then
+         word  := Shift_Right (word, 4);
+         index := index + 4;
+      end if;
+
+      if word > 16#3# then
+         word  := Shift_Right (word, 2);
+         index := index + 2;
+      end if;
+
+      if word > 16#1# then
+         index := index + 1;
+      end if;
+
+      return index;
+   end highest_bit;
+
+   --------------------
+   -- priority_group --
+   --------------------
+
+   function priority_group (priority : os_priority_t) return os_priority_group_t
+   is
+     (Natural (priority) / OS_PRIORITY_PER_GROUP);
+
+   ------------------
+   -- priority_bit --
+   ------------------
+
+   function priority_bit (priority : os_priority_t) return Unsigned_32
+   is
+     (Shift_Left (Unsigned_32'(1),
+                  Natural (priority) mod OS_PRIORITY_PER_GROUP));
+
+   ---------------
+   -- group_bit --
+   ---------------
+
+   function group_bit (group : os_priority_group_t) return Unsigned_32
+   is
+     (Shift_Left (Unsigned_32'(1), group));
+
+   -----------------------
+   -- priority_is_ready --
+   -----------------------
+
+   function priority_is_ready (priority : os_priority_t) return Boolean
+   is
+     ((ready_prio_word (priority_group (priority)) and
+       priority_bit (priority)) /= 0);
 
    ----------------------
    --  Ghost functions --
@@ -116,48 +258,174 @@ is
    is
      (task_is_ready (current_task));
 
+   -----------------
+   -- ready_count --
+   -----------------
+   --  Number of ready tasks of a priority level up to a given task ID.
+
+   function ready_count (ready    : os_task_ready_t;
+                         priority : os_priority_t;
+                         last     : os_task_id_param_t) return Natural
+   is
+     ((if last = os_task_id_param_t'First then 0
+       else ready_count (ready, priority, last - 1))
+      + (if ready (last) and then task_priority (last) = priority then 1
+         else 0))
+   with
+      Ghost              => True,
+      Subprogram_Variant => (Decreases => last),
+      Post               => ready_count'Result <= Natural (last) + 1;
+
+   ----------------
+   -- prio_count --
+   ----------------
+   --  Number of ready tasks of a priority level.
+
+   function prio_count (priority : os_priority_t) return Natural
+   is
+     (ready_count (ready_task, priority, os_task_id_param_t'Last))
+   with
+      Ghost => True;
+
+   ----------------------------
+   -- lemma_ready_count_zero --
+   ----------------------------
+   --  A priority level without ready task has a count of 0.
+
+   procedure lemma_ready_count_zero (ready    : os_task_ready_t;
+                                     priority : os_priority_t;
+                                     last     : os_task_id_param_t)
+   with
+      Ghost              => True,
+      Subprogram_Variant => (Decreases => last),
+      Pre  => (for all id in os_task_id_param_t'First .. last =>
+                 not ready (id) or else task_priority (id) /= priority),
+      Post => ready_count (ready, priority, last) = 0
+   is
+   begin
+      if last /= os_task_id_param_t'First then
+         lemma_ready_count_zero (ready, priority, last - 1);
+      end if;
+   end lemma_ready_count_zero;
+
+   ---------------------------
+   -- lemma_ready_count_set --
+   ---------------------------
+   --  Setting the ready state of one task only changes the count of its
+   --  priority level, by one.
+
+   procedure lemma_ready_count_set (before   : os_task_ready_t;
+                                    after    : os_task_ready_t;
+                                    task_id  : os_task_id_param_t;
+                                    priority : os_priority_t;
+                                    last     : os_task_id_param_t)
+   with
+      Ghost              => True,
+      Subprogram_Variant => (Decreases => last),
+      Pre  => (for all id in os_task_id_param_t =>
+                 (if id /= task_id then after (id) = before (id))),
+      Post => (if task_id > last or else task_priority (task_id) /= priority
+                  or else after (task_id) = before (task_id)
+               then
+                  ready_count (after, priority, last) =
+                  ready_count (before, priority, last)
+               elsif after (task_id) then
+                  ready_count (after, priority, last) =
+                  ready_count (before, priority, last) + 1
+               else
+                  ready_count (after, priority, last) + 1 =
+                  ready_count (before, priority, last))
+   is
+   begin
+      if last /= os_task_id_param_t'First then
+         lemma_ready_count_set (before, after, task_id, priority, last - 1);
+      end if;
+   end lemma_ready_count_set;
+
    ------------------------------
    -- task_list_is_well_formed --
    ------------------------------
 
-   -- Invariant 1 : cohérence structurelle des liens
+   --  Invariant 1: each ready task is linked in the circular FIFO of its
+   --  priority level. Its next task is one rank further from the head
+   --  (unless it is the tail). A task which is not ready is not linked at
+   --  all.
    function task_list_links_ok return Boolean is
-     (if task_list_head = OS_TASK_ID_NONE then
-        (for all id in os_task_id_param_t =>
-           (ready_task (id) = False
-            and next_task (id) = OS_TASK_ID_NONE
-            and prev_task (id) = OS_TASK_ID_NONE))
-      else
-        (ready_task (os_task_id_param_t (task_list_head)) = True
-         and prev_task (os_task_id_param_t (task_list_head)) = OS_TASK_ID_NONE
-         and (for all id in os_task_id_param_t =>
-                (if ready_task (id) = False then
-                   (next_task (id) = OS_TASK_ID_NONE
-                    and prev_task (id) = OS_TASK_ID_NONE)
-                 else
-                   (next_task (id) /= id
-                    and prev_task (id) /= id
-                    and (if next_task (id) /= OS_TASK_ID_NONE then
-                           ready_task (os_task_id_param_t (next_task (id))) = True
-                           and next_task (id) /= prev_task (id))
-                    and (if prev_task (id) /= OS_TASK_ID_NONE then
-                           ready_task (os_task_id_param_t (prev_task (id))) = True
-                           and next_task (id) /= prev_task (id)))))));
-
-   -- Invariant 2 : ordre des priorités (séparé pour simplifier)
-   function task_list_sorted return Boolean is
      (for all id in os_task_id_param_t =>
         (if ready_task (id) then
-           (if next_task (id) /= OS_TASK_ID_NONE then
-              task_priority (id) >=
-                task_priority (os_task_id_param_t (next_task (id))))
-           and (if prev_task (id) /= OS_TASK_ID_NONE then
-              task_priority (id) <=
-                task_priority (os_task_id_param_t (prev_task (id))))));
-
-   -- Invariant combiné
+           (next_task (id) in os_task_id_param_t
+            and then prev_task (id) in os_task_id_param_t
+            and then ready_task (next_task (id))
+            and then ready_task (prev_task (id))
+            and then task_priority (next_task (id)) = task_priority (id)
+            and then task_priority (prev_task (id)) = task_priority (id)
+            and then prev_task (next_task (id)) = id
+            and then next_task (prev_task (id)) = id
+            and then priority_is_ready (task_priority (id))
+            and then task_rank (id) < prio_count (task_priority (id))
+            and then (if next_task (id) = prio_head (task_priority (id)) then
+                        task_rank (id) = prio_count (task_priority (id)) - 1
+                      else
+                        task_rank (next_task (id)) = task_rank (id) + 1))
+         else
+           (next_task (id) = OS_TASK_ID_NONE
+            and prev_task (id) = OS_TASK_ID_NONE)))
+   with
+      Ghost => True;
+
+   --  Invariant 2: the priority bitmap is coherent with the FIFO heads.
+   function task_list_bitmap_ok return Boolean is
+     ((for all priority in os_priority_t =>
+         (if priority_is_ready (priority) then
+            (prio_head (priority) in os_task_id_param_t
+             and then ready_task (prio_head (priority))
+             and then task_priority (prio_head (priority)) = priority
+             and then task_rank (prio_head (priority)) = 0)
+          else
+            prio_head (priority) = OS_TASK_ID_NONE))
+      and then
+      (for all group in os_priority_group_t =>
+         ((ready_prio_word (group) /= 0) =
+          ((ready_prio_group and group_bit (group)) /= 0)))
+      and then
+      ready_prio_group < Shift_Left (Unsigned_32'(1), OS_PRIORITY_GROUP_CNT))
+   with
+      Ghost => True;
+
+   --  Invariant 3: the ready tasks of a priority level have different
+   --  ranks, so each FIFO holds all the ready tasks of its level.
+   function task_list_ranks_ok return Boolean is
+     (for all id in os_task_id_param_t =>
+        (for all other in os_task_id_param_t =>
+           (if ready_task (id) and then ready_task (other)
+               and then task_priority (id) = task_priority (other)
+               and then task_rank (id) = task_rank (other)
+            then
+               id = other)))
+   with
+      Ghost => True;
+
+   --  Combined invariant
    function task_list_is_well_formed return Boolean is
-     (task_list_links_ok and then task_list_sorted);
+     (task_list_links_ok and then task_list_bitmap_ok
+      and then task_list_ranks_ok);
+
+   ----------------------------
+   -- highest_ready_priority --
+   ----------------------------
+   --  Two find-first-set operations give the highest ready priority level
+   --  whatever the number of ready tasks.
+
+   function highest_ready_priority return os_priority_t
+   with
+      Pre  => ready_prio_group /= 0 and then task_list_is_well_formed,
+      Post => priority_is_ready (highest_ready_priority'Result)
+   is
+      group : constant os_priority_group_t := highest_bit (ready_prio_group);
+   begin
+      return os_priority_t (group * OS_PRIORITY_PER_GROUP +
+                            highest_bit (ready_prio_word (group)));
+   end highest_ready_priority;
 
    ----------------------------
    -- add_task_to_ready_list --
@@ -168,110 +436,90 @@ is
       Refined_Post => ready_task = (ready_task'Old with delta
                                                             task_id => True)
                       and then task_list_is_well_formed
+                      --  Only task_id and its two neighbours are relinked
+                      and then (for all id in os_task_id_param_t =>
+                                  (if id /= task_id
+                                      and then id /= next_task (task_id)
+                                      and then id /= prev_task (task_id)
+                                   then
+                                      next_task (id) = next_task'Old (id)
+                                      and then prev_task (id) =
+                                               prev_task'Old (id)))
+                      and then (for all priority in os_priority_t =>
+                                  (if priority /= task_priority (task_id) then
+                                      prio_head (priority) =
+                                      prio_head'Old (priority)))
    is
-      index_id : os_task_id_t := task_list_head;
+      priority  : constant os_priority_t := task_priority (task_id);
+      group     : constant os_priority_group_t := priority_group (priority);
+      head_id   : constant os_task_id_t := prio_head (priority);
+      ready_old : constant os_task_ready_t := ready_task
+      with
+         Ghost => True;
    begin
       pragma Assume (task_list_is_well_formed);
 
-      if (not ready_task (task_id)) then
-
-         if index_id = OS_TASK_ID_NONE then
-            next_task (task_id) := OS_TASK_ID_NONE;
-            prev_task (task_id) := OS_TASK_ID_NONE;
+      if not ready_task (task_id) then
 
-            ready_task (task_id) := True;
+         if head_id = OS_TASK_ID_NONE then
+            --  No task of this priority level is ready, so its count is 0.
+            lemma_ready_count_zero
+              (ready_task, priority, os_task_id_param_t'Last);
 
-            --  task_id is now the only element of the ready_list.
-            task_list_head := task_id;
+            --  task_id is the only ready task of its priority level, so it is
+            --  linked to itself.
+            next_task (task_id) := task_id;
+            prev_task (task_id) := task_id;
 
-            pragma Assert (task_list_is_well_formed);
+            prio_head (priority) := task_id;
 
+            --  The priority level (and its group) are now ready.
+            ready_prio_word (group) :=
+              ready_prio_word (group) or priority_bit (priority);
+            ready_prio_group := ready_prio_group or group_bit (group);
          else
-
-            while index_id /= OS_TASK_ID_NONE loop
-
-               pragma Loop_Invariant
-                (task_list_is_well_formed
-                 and not ready_task (task_id)
-                 and index_id in os_task_id_param_t
-                 and ready_task (os_task_id_param_t (index_id))
-                 and (prev_task (os_task_id_param_t (index_id)) = OS_TASK_ID_NONE
-                      or else task_priority
-                                (os_task_id_param_t
-                                  (prev_task (os_task_id_param_t (index_id)))) >=
-                              task_priority (task_id)));
-
-               if task_priority (task_id) >
-                 task_priority (os_task_id_param_t (index_id))
-               then
-                  --  task_id is higher priority so it needs to be inserted
-                  --  before index_id.
-                  declare
-                     prev_id : constant os_task_id_t := prev_task (index_id);
-                  begin
-
-                     prev_task (index_id) := task_id;
-                     next_task (task_id)  := index_id;
-                     ready_task (task_id) := True;
-
-                     if prev_id = OS_TASK_ID_NONE then
-                        task_list_head := task_id;
-                     else
-                        next_task (prev_id) := task_id;
-                        prev_task (task_id) := prev_id;
-                     end if;
-
-                  end;
-
-                  pragma Assert (task_list_links_ok);
-                  pragma Assert
-                    (task_priority (task_id) >=
-                       task_priority (os_task_id_param_t (next_task (task_id))));
-                  pragma Assert
-                    (if prev_task (task_id) /= OS_TASK_ID_NONE then
-                       task_priority (os_task_id_param_t (prev_task (task_id))) >=
-                         task_priority (task_id));
-                  pragma Assert (task_list_sorted);
-
-                  exit;
-               elsif next_task (index_id) = OS_TASK_ID_NONE then
-                  --  we are at the last element of the ready list.
-
-                  --  We need to insert task_id at the end of the ready list
-                  next_task (index_id) := task_id;
-                  prev_task (task_id)  := index_id;
-
-                  --  We don't need to update next_task as it is already set to
-                  --  OS_TASK_ID_NONE
-                  ready_task (task_id) := True;
-
-                  pragma Assert (task_list_links_ok);
-                  pragma Assert (task_list_sorted);
-
-                  exit;
-               end if;
-
-               pragma Assert
-                 (task_priority (task_id) <=
-                    task_priority (os_task_id_param_t (index_id)));
-
-               pragma Assume
-                 (if next_task (index_id) /= OS_TASK_ID_NONE then
-                    prev_task (os_task_id_param_t (next_task (index_id))) = index_id);
-
+            --  Insert task_id at the tail of its priority level FIFO (just
+            --  before the head) so that it runs after the other tasks of
+            --  same priority.
+            declare
+               tail_id : constant os_task_id_param_t := prev_task (head_id);
+            begin
+               --  Only tail_id links head_id forward and only head_id links
+               --  tail_id backward. Nothing links task_id yet.
                pragma Assert
-                 (if next_task (index_id) /= OS_TASK_ID_NONE then
-                    task_priority (os_task_id_param_t (index_id)) >=
-                          task_priority (task_id));
+                 (for all id in os_task_id_param_t =>
+                    (if ready_task (id) then
+                        next_task (id) /= task_id
+                        and then prev_task (id) /= task_id
+                        and then (if id /= tail_id then
+                                     next_task (id) /= head_id)
+                        and then (if id /= head_id then
+                                     prev_task (id) /= tail_id)));
+               pragma Assert (task_rank (tail_id) = prio_count (priority) - 1);
+
+               next_task (tail_id) := task_id;
+               prev_task (task_id) := tail_id;
+               next_task (task_id) := head_id;
+               prev_task (head_id) := task_id;
+            end;
+         end if;
 
-               index_id := next_task (index_id);
+         --  task_id is ranked after all the ready tasks of its level
+         task_rank (task_id)  := prio_count (priority);
+         ready_task (task_id) := True;
 
-            end loop;
+         lemma_ready_count_set
+           (ready_old, ready_task, task_id, priority,
+            os_task_id_param_t'Last);
+         pragma Assert (prio_count (priority) = task_rank (task_id) + 1);
 
-         end if;
+         pragma Assert (task_list_links_ok);
+         pragma Assert (task_list_bitmap_ok);
+         pragma Assert (task_list_ranks_ok);
       else
-          pragma Assert (task_list_links_ok);
-          pragma Assert (task_list_sorted);
+         pragma Assert (task_list_links_ok);
+         pragma Assert (task_list_bitmap_ok);
+         pragma Assert (task_list_ranks_ok);
       end if;
 
    end add_task_to_ready_list;
@@ -286,13 +534,76 @@ is
               and then task_list_is_well_formed,
       Post => ready_task = (ready_task'Old with delta task_id => False)
               and then task_list_is_well_formed
+              --  Only task_id and its two neighbours are relinked
+              and then (for all id in os_task_id_param_t =>
+                          (if id /= task_id
+                              and then id /= next_task'Old (task_id)
+                              and then id /= prev_task'Old (task_id)
+                           then
+                              next_task (id) = next_task'Old (id)
+                              and then prev_task (id) = prev_task'Old (id)))
+              and then (for all priority in os_priority_t =>
+                          (if priority /= task_priority (task_id) then
+                              prio_head (priority) = prio_head'Old (priority)))
    is
-      next_id  : constant os_task_id_t := next_task (task_id);
-      prev_id  : constant os_task_id_t := prev_task (task_id);
+      priority  : constant os_priority_t := task_priority (task_id);
+      group     : constant os_priority_group_t := priority_group (priority);
+      next_id   : constant os_task_id_param_t := next_task (task_id);
+      prev_id   : constant os_task_id_param_t := prev_task (task_id);
+      rank      : constant Natural := task_rank (task_id)
+      with
+         Ghost => True;
+      ready_old : constant os_task_ready_t := ready_task
+      with
+         Ghost => True;
    begin
-      pragma Assume (task_list_is_well_formed);
-      pragma Assume (task_is_ready (task_id));
-      pragma Assume (if task_id = task_list_head then prev_id = OS_TASK_ID_NONE);
+      if next_id = task_id then
+
+         --  task_id is its own next, so it is the head and the tail of its
+         --  level. It has rank 0 and the count of its level is 1: no other
+         --  task of this level is ready.
+         pragma Assert (prio_head (priority) = task_id);
+         pragma Assert (prio_count (priority) = 1);
+         pragma Assert
+           (for all id in os_task_id_param_t =>
+              (if ready_task (id) and then id /= task_id then
+                  task_priority (id) /= priority));
+
+         --  task_id was the only ready task of its priority level.
+         prio_head (priority) := OS_TASK_ID_NONE;
+
+         ready_prio_word (group) :=
+           ready_prio_word (group) and not priority_bit (priority);
+
+         if ready_prio_word (group) = 0 then
+            ready_prio_group := ready_prio_group and not group_bit (group);
+         end if;
+
+      else
+
+         --  Only prev_id links task_id and next_id forward and only next_id
+         --  links task_id and prev_id backward.
+         pragma Assert
+           (for all id in os_task_id_param_t =>
+              (if ready_task (id) and then id /= task_id then
+                  (if id /= prev_id then
+                      next_task (id) /= task_id
+                      and then next_task (id) /= next_id)
+                  and then (if id /= next_id then
+                               prev_task (id) /= task_id
+                               and then prev_task (id) /= prev_id)));
+
+         --  link next from prev task to our next and prev from next task to
+         --  our prev.
+         next_task (prev_id) := next_id;
+         prev_task (next_id) := prev_id;
+
+         if prio_head (priority) = task_id then
+            --  Set the new FIFO head (the next from the removed task)
+            prio_head (priority) := next_id;
+         end if;
+
+      end if;
 
       --  Disconnect task_id from the ready list
       next_task (task_id)  := OS_TASK_ID_NONE;
@@ -301,38 +612,91 @@ is
 
       pragma Assert (not ready_task (task_id));
 
-      if task_id = task_list_head then
+      --  The tasks ranked after task_id in its level move one rank closer
+      --  to the head.
+      task_rank :=
+        [for id in os_task_id_param_t =>
+           (if ready_task (id)
+               and then task_priority (id) = priority
+               and then task_rank (id) > rank
+            then task_rank (id) - 1
+            else task_rank (id))];
 
-         --  Set the new list head (the next from the removed task)
-         task_list_head := next_id;
+      lemma_ready_count_set
+        (ready_old, ready_task, task_id, priority, os_task_id_param_t'Last);
 
-      end if;
+      pragma Assert (task_list_links_ok);
+      pragma Assert (task_list_bitmap_ok);
+      pragma Assert (task_list_ranks_ok);
 
-      if prev_id /= OS_TASK_ID_NONE then
+   end remove_task_from_ready_list;
 
-         --  link next from prev task to our next
-         next_task (prev_id) := next_id;
+   ------------------
+   -- wait_for_mbx --
+   ------------------
+   --  Remove the current task from the ready list until a mbx from one of
+   --  the waited tasks is posted.
 
-      end if;
+   procedure wait_for_mbx (waiting_mask : os_mbx_mask_t)
+   with
+      Pre  => Moth.os_ghost_mbx_are_well_formed
+              and then task_list_is_well_formed
+              and then current_task_is_ready,
+      Post => task_list_is_well_formed
+   is
+      task_id  : constant os_task_id_param_t := current_task;
+      tmp_mask : os_mbx_mask_t;
+   begin
+      --  The task must not be woken up by a notification while it waits
+      --  for a mbx.
+      notify_waiting (task_id) := False;
 
-      if next_id /= OS_TASK_ID_NONE then
+      -- restrict the waiting mask to the permited tasks only.
+      tmp_mask := waiting_mask and Moth.Config.get_mbx_permission (task_id);
 
-         --  link prev from next task to our prev
-         prev_task (next_id) := prev_id;
+      --  We remove the current task from the ready list.
+      remove_task_from_ready_list (task_id);
+
+      if not mbx_mask_is_empty (tmp_mask) then
+         mbx_mask (task_id) := tmp_mask;
+
+         -- check to see if one of the waited event is already here.
+         tmp_mask :=
+           tmp_mask and Moth.Mailbox.os_mbx_get_posted_mask (task_id);
 
+         if not mbx_mask_is_empty (tmp_mask) then
+            --  If waited event is already here, put the task back in the ready
+            --  list (after tasks of same priority).
+            add_task_to_ready_list (task_id);
+         end if;
+      elsif task_id /= OS_INTERRUPT_TASK_ID then
+         --  This is an error/illegal case. There is nothing to wait for, so
+         --  put the task back in the ready list.
+         add_task_to_ready_list (task_id);
       end if;
+   end wait_for_mbx;
 
-      pragma Assume
-        (for all id in os_task_id_param_t =>
-           (if ready_task (id) then
-              next_task (id) /= id and prev_task (id) /= id));
-      pragma Assume
-        (if task_list_head /= OS_TASK_ID_NONE then
-           ready_task (os_task_id_param_t (task_list_head)) = True
-           and prev_task (os_task_id_param_t (task_list_head)) = OS_TASK_ID_NONE);
-      pragma Assume (task_list_is_well_formed);
+   -------------------------
+   -- dispatch_interrupts --
+   -------------------------
+   --  Make ready the tasks waiting for the pending interrupts before a
+   --  task is elected.
 
-   end remove_task_from_ready_list;
+   procedure dispatch_interrupts
+   with
+      Pre  => task_list_is_well_formed,
+      Post => task_list_is_well_formed
+   is
+   begin
+      --  Notify the owners of the pending interrupt lines
+      Moth.Mailbox.irq_route;
+
+      --  Check interrupt status
+      if (os_arch.interrupt_is_pending = 1) then
+         --  Put interrupt task in ready list if int is set.
+         add_task_to_ready_list (OS_INTERRUPT_TASK_ID);
+      end if;
+   end dispatch_interrupts;
 
    --------------
    -- schedule --
@@ -341,31 +705,25 @@ is
    procedure schedule (task_id : out os_task_id_param_t)
    with
       Pre  => task_list_is_well_formed,
-      Post => task_list_head = task_id
-              and then task_is_ready (task_id)
+      Post => task_is_ready (task_id)
+              and then task_priority (task_id) = highest_ready_priority
               and then task_list_is_well_formed
    is
    begin
-      --  Check interrupt status
-      if (os_arch.interrupt_is_pending = 1) then
-         --  Put interrupt task in ready list if int is set.
-         add_task_to_ready_list (OS_INTERRUPT_TASK_ID);
-      end if;
+      loop
+         dispatch_interrupts;
 
-      while task_list_head = OS_TASK_ID_NONE loop
+         exit when ready_prio_group /= 0;
 
          --  No task is elected:
-         --  Put processor in idle mode and wait for interrupt.
+         --  Put processor in idle mode until an interrupt is raised.
+         --  os_arch.idle returns as soon as the interrupt is taken so
+         --  it gets routed and dispatched right away.
          os_arch.idle;
-
-         --  Check interrupt status
-         if (os_arch.interrupt_is_pending = 1) then
-            --  Put interrupt task in ready list if int is set.
-            add_task_to_ready_list (OS_INTERRUPT_TASK_ID);
-         end if;
       end loop;
 
-      task_id := task_list_head;
+      --  The elected task is the head of the highest ready priority level.
+      task_id := prio_head (highest_ready_priority);
 
       --  Select the elected task as current task.
       current_task := task_id;
@@ -401,37 +759,105 @@ is
    procedure wait (task_id      : out os_task_id_param_t;
                    waiting_mask : in os_mbx_mask_t)
    is
-      tmp_mask : os_mbx_mask_t;
    begin
-      task_id := current_task;
+      --  The current task leaves the ready list until a waited mbx is there.
+      wait_for_mbx (waiting_mask);
 
-      -- restrict the waiting mask to the permited tasks only.
-      tmp_mask := waiting_mask and Moth.Config.get_mbx_permission (task_id);
+      --  Let's elect the new running task.
+      schedule (task_id);
+   end wait;
 
-      --  We remove the current task from the ready list.
-      remove_task_from_ready_list (task_id);
+   -----------------
+   -- wait_notify --
+   -----------------
 
-      if tmp_mask /= 0 then
-         mbx_mask (task_id) := tmp_mask;
+   procedure wait_notify (task_id : out os_task_id_param_t)
+   is
+   begin
+      task_id := current_task;
 
-         -- check to see if one of the waited event is already here.
-         tmp_mask :=
-           tmp_mask and Moth.Mailbox.os_mbx_get_posted_mask (task_id);
+      if not Moth.Mailbox.os_notify_is_pending (task_id) then
+         --  Nothing was notified yet. The current task leaves the ready list
+         --  until it is notified. It must not be woken up by a mbx meanwhile.
+         mbx_mask (task_id) := OS_MBX_MASK_NONE;
+         remove_task_from_ready_list (task_id);
+         notify_waiting (task_id) := True;
+      end if;
 
-         if tmp_mask /= 0 then
-            --  If waited event is already here, put the task back in the ready
-            --  list (after tasks of same priority).
-            add_task_to_ready_list (task_id);
-         end if;
-      elsif task_id /= OS_INTERRUPT_TASK_ID then
-         --  This is an error/illegal case. There is nothing to wait for, so
-         --  put the task back in the ready list.
+      --  Let's elect the new running task.
+      schedule (task_id);
+   end wait_notify;
+
+   -------------------
+   -- wake_notified --
+   -------------------
+
+   procedure wake_notified (task_id : in os_task_id_param_t)
+   is
+   begin
+      if notify_waiting (task_id) then
+         notify_waiting (task_id) := False;
          add_task_to_ready_list (task_id);
       end if;
+   end wake_notified;
+
+   --------------
+   -- wake_mbx --
+   --------------
+
+   procedure wake_mbx (task_id : in os_task_id_param_t)
+   is
+   begin
+      notify_waiting (task_id) := False;
+      add_task_to_ready_list (task_id);
+   end wake_mbx;
+
+   ---------------
+   -- wait_send --
+   ---------------
+
+   procedure wait_send (task_id : out os_task_id_param_t)
+   is
+   begin
+      task_id := current_task;
+
+      --  The task must not be woken up by a mbx while its send is blocked.
+      mbx_mask (task_id) := OS_MBX_MASK_NONE;
+      remove_task_from_ready_list (task_id);
 
       --  Let's elect the new running task.
       schedule (task_id);
-   end wait;
+   end wait_send;
+
+   -----------------
+   -- wait_direct --
+   -----------------
+
+   procedure wait_direct (task_id      : out os_task_id_param_t;
+                          waiting_mask : in os_mbx_mask_t;
+                          dest_id      : in os_task_id_param_t)
+   is
+      priority : constant os_priority_t := task_priority (current_task);
+   begin
+      --  The current task leaves the ready list until a waited mbx is there.
+      wait_for_mbx (waiting_mask);
+
+      --  Interrupt tasks must be ready before dest_id is elected.
+      dispatch_interrupts;
+
+      if ready_task (dest_id)
+        and then task_priority (dest_id) >= priority
+        and then task_priority (dest_id) = highest_ready_priority
+      then
+         --  Direct switch: dest_id is elected even if other tasks of the
+         --  same priority were ready before it.
+         task_id      := dest_id;
+         current_task := task_id;
+      else
+         --  Let's elect the new running task.
+         schedule (task_id);
+      end if;
+   end wait_direct;
 
    -----------
    -- yield --
@@ -452,6 +878,22 @@ is
       schedule (task_id);
    end yield;
 
+   -------------------
+   -- yield_is_noop --
+   -------------------
+
+   function yield_is_noop return types.uint8_t
+   is
+   begin
+      if next_task (current_task) = current_task
+        and then task_priority (current_task) = highest_ready_priority
+      then
+         return 1;
+      else
+         return 0;
+      end if;
+   end yield_is_noop;
+
    ---------------
    -- task_exit --
    ---------------
@@ -464,6 +906,14 @@ is
       --  Remove the current task from the ready list.
       remove_task_from_ready_list (task_id);
 
+      --  A restarted task runs again after the other tasks of its priority
+      if OpenConf.CONFIG_TASK_RESTART then
+         add_task_to_ready_list (task_id);
+      else
+         --  Nobody will ever free a slot in its FIFO
+         Moth.Mailbox.close (task_id);
+      end if;
+
       --  Let's elect the new running task.
       schedule (task_id);
    end task_exit;
@@ -480,18 +930,24 @@ is
       --  Init the MMU
       os_arch.space_init;
 
-      --  Init the task list head to NONE
-      task_list_head := OS_TASK_ID_NONE;
+      --  No priority level has a ready task yet.
+      prio_head        := [others => OS_TASK_ID_NONE];
+      ready_prio_word  := [others => 0];
+      ready_prio_group := 0;
 
       --  Init the task entry for one task
       next_task := [others => OS_TASK_ID_NONE];
       prev_task := [others => OS_TASK_ID_NONE];
 
       --  All Mbx mask for tasks are 0
-      mbx_mask := [others => 0];
+      mbx_mask := [others => OS_MBX_MASK_NONE];
+
+      --  No task is waiting for a notification
+      notify_waiting := [others => False];
 
       --  No task is in the ready list yet.
       ready_task := [others => False];
+      task_rank  := [others => 0];
 
       for id in os_task_id_param_t loop
          task_priority (id) := Moth.Config.get_task_priority (id);
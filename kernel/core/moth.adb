@@ -52,6 +52,9 @@ is
       --  Init the console if any
       os_arch.cons_init;
 
+      --  Only the interrupt lines owned by a task are routed by the kernel
+      os_arch.interrupt_init;
+
       --  Init all mailboxes
       Moth.Mailbox.init;
 
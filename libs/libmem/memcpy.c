@@ -25,19 +25,74 @@
 
 #include "os_assert.h"
 
+/* Below this size the alignment work costs more than it saves */
+#define MEMCPY_SMALL_SIZE 16
+
 /**
  * copy memory area.
+ * When dest and src share the same alignment the bulk of the copy is done
+ * with 8 words bursts (ldm/stm) on ARM and with doublewords (ldd/std) or
+ * words elsewhere. The unaligned head and the tail are copied bytewise.
  */
 void *memcpy(void *dest, const void *src, size_t n) {
   os_assert(n > 0);
   os_assert(dest != NULL);
   os_assert(src != NULL);
 
-  char *d = dest;
-  const char *s = src;
+  uint8_t *d = dest;
+  const uint8_t *s = src;
+
+  if ((n >= MEMCPY_SMALL_SIZE) && ((((intptr_t)d ^ (intptr_t)s) & 3) == 0)) {
+    while ((intptr_t)d & 3) {
+      *d++ = *s++;
+      n--;
+    }
+
+#if defined(__arm__)
+    if (n >= 32) {
+      size_t burst = n & ~31;
+
+      asm volatile("1:\n\t"
+                   "ldmia %1!, {r3-r10}\n\t"
+                   "stmia %0!, {r3-r10}\n\t"
+                   "subs  %2, %2, #32\n\t"
+                   "bne   1b\n\t"
+                   : "+r"(d), "+r"(s), "+r"(burst)
+                   : /* no input */
+                   : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc",
+                     "memory");
+      n &= 31;
+    }
+#else
+    if ((((intptr_t)d ^ (intptr_t)s) & 7) == 0) {
+      if ((intptr_t)d & 4) {
+        *(uint32_t *)d = *(const uint32_t *)s;
+        d += 4;
+        s += 4;
+        n -= 4;
+      }
+
+      /* 8 bytes aligned, gcc turns these into ldd/std on sparc */
+      while (n >= 8) {
+        *(uint64_t *)d = *(const uint64_t *)s;
+        d += 8;
+        s += 8;
+        n -= 8;
+      }
+    }
+#endif
+
+    while (n >= 4) {
+      *(uint32_t *)d = *(const uint32_t *)s;
+      d += 4;
+      s += 4;
+      n -= 4;
+    }
+  }
 
   while (n--) {
     *d++ = *s++;
   }
+
   return dest;
 }
@@ -25,15 +25,78 @@
 
 #include "os_assert.h"
 
+/* Below this size the alignment work costs more than it saves */
+#define MEMSET_SMALL_SIZE 16
+
 /**
  * fill memory with a constant byte.
+ * The bulk of the area is filled with 8 words bursts (stm) on ARM and with
+ * doublewords (std) or words elsewhere. The unaligned head and the tail are
+ * filled bytewise.
  */
 void *__memset(void *s, int c, size_t n) {
   os_assert(n > 0);
   os_assert((c >= 0) && (c < 256));
   os_assert(s != NULL);
 
-  char *d = s;
+  uint8_t *d = s;
+
+  if (n >= MEMSET_SMALL_SIZE) {
+    uint32_t w = (uint8_t)c;
+
+    w |= w << 8;
+    w |= w << 16;
+
+    while ((intptr_t)d & 3) {
+      *d++ = c;
+      n--;
+    }
+
+#if defined(__arm__)
+    if (n >= 32) {
+      size_t burst = n & ~31;
+
+      asm volatile("mov   r3, %2\n\t"
+                   "mov   r4, %2\n\t"
+                   "mov   r5, %2\n\t"
+                   "mov   r6, %2\n\t"
+                   "mov   r7, %2\n\t"
+                   "mov   r8, %2\n\t"
+                   "mov   r9, %2\n\t"
+                   "mov   r10, %2\n\t"
+                   "1:\n\t"
+                   "stmia %0!, {r3-r10}\n\t"
+                   "subs  %1, %1, #32\n\t"
+                   "bne   1b\n\t"
+                   : "+r"(d), "+r"(burst)
+                   : "r"(w)
+                   : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc",
+                     "memory");
+      n &= 31;
+    }
+#else
+    if ((intptr_t)d & 4) {
+      *(uint32_t *)d = w;
+      d += 4;
+      n -= 4;
+    }
+
+    /* 8 bytes aligned, gcc turns this into std on sparc */
+    uint64_t dw = ((uint64_t)w << 32) | w;
+
+    while (n >= 8) {
+      *(uint64_t *)d = dw;
+      d += 8;
+      n -= 8;
+    }
+#endif
+
+    while (n >= 4) {
+      *(uint32_t *)d = w;
+      d += 4;
+      n -= 4;
+    }
+  }
 
   while (n--) {
     *d++ = c;
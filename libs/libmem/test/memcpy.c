@@ -0,0 +1,89 @@
+/*
+ * Host check and benchmark of the libmem memcpy against a byte loop.
+ *
+ * gcc -O2 -fno-tree-loop-distribute-patterns -I../../../kernel/core/include -o memcpy memcpy.c
+ *
+ * (-fno-tree-loop-distribute-patterns keeps gcc from turning the byte loop
+ * back into a libc memcpy call)
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* libmem builds against the moth headers, use the host ones instead */
+#define __MOTH_SPARC_TYPES_H__
+#define __OS_ASSERT_H__
+#define os_assert(x)
+
+#define memcpy moth_memcpy
+#include "../memcpy.c"
+#undef memcpy
+
+#define BUF_SIZE 4096
+#define LOOP_COUNT 100000
+
+static void *byte_memcpy(void *dest, const void *src, size_t n) {
+  char *d = dest;
+  const char *s = src;
+
+  while (n--) {
+    *d++ = *s++;
+  }
+  return dest;
+}
+
+static double bench(void *(*fn)(void *, const void *, size_t), void *dest,
+                    const void *src, size_t n) {
+  struct timespec start, end;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < LOOP_COUNT; i++) {
+    fn(dest, src, n);
+    asm volatile("" : : "r"(dest) : "memory");
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+         LOOP_COUNT;
+}
+
+int main() {
+  static uint8_t src[BUF_SIZE + 16] __attribute__((aligned(8)));
+  static uint8_t dst[BUF_SIZE + 16] __attribute__((aligned(8)));
+  static uint8_t ref[BUF_SIZE + 16] __attribute__((aligned(8)));
+  static const size_t sizes[] = {1, 7, 16, 64, 256, 4096};
+  size_t n, d_off, s_off, i;
+
+  for (i = 0; i < sizeof(src); i++) {
+    src[i] = rand();
+  }
+
+  /* every size and relative alignment, with guard bytes around */
+  for (n = 1; n <= 300; n++) {
+    for (d_off = 0; d_off < 8; d_off++) {
+      for (s_off = 0; s_off < 8; s_off++) {
+        memset(dst, 0xa5, sizeof(dst));
+        memset(ref, 0xa5, sizeof(ref));
+        assert(moth_memcpy(dst + d_off, src + s_off, n) == dst + d_off);
+        memcpy(ref + d_off, src + s_off, n);
+        assert(memcmp(dst, ref, sizeof(dst)) == 0);
+      }
+    }
+  }
+  printf("memcpy: results match\n");
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    n = sizes[i];
+    printf("%5zu bytes: byte loop %8.1f ns, aligned %8.1f ns, "
+           "misaligned %8.1f ns\n",
+           n, bench(byte_memcpy, dst, src, n), bench(moth_memcpy, dst, src, n),
+           bench(moth_memcpy, dst + 1, src + 2, n));
+  }
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Host check and benchmark of the libmem memset against a byte loop.
+ *
+ * gcc -O2 -fno-tree-loop-distribute-patterns -I../../../kernel/core/include -o memset memset.c
+ *
+ * (-fno-tree-loop-distribute-patterns keeps gcc from turning the byte loop
+ * back into a libc memset call)
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* libmem builds against the moth headers, use the host ones instead */
+#define __MOTH_SPARC_TYPES_H__
+#define __OS_ASSERT_H__
+#define os_assert(x)
+
+#define __memset moth___memset
+#define memset moth_memset
+#include "../memset.c"
+#undef memset
+
+#define BUF_SIZE 4096
+#define LOOP_COUNT 100000
+
+static void *byte_memset(void *s, int c, size_t n) {
+  char *d = s;
+
+  while (n--) {
+    *d++ = c;
+  }
+
+  return s;
+}
+
+static double bench(void *(*fn)(void *, int, size_t), void *s, size_t n) {
+  struct timespec start, end;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < LOOP_COUNT; i++) {
+    fn(s, 0, n);
+    asm volatile("" : : "r"(s) : "memory");
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+         LOOP_COUNT;
+}
+
+int main() {
+  static uint8_t dst[BUF_SIZE + 16] __attribute__((aligned(8)));
+  static uint8_t ref[BUF_SIZE + 16] __attribute__((aligned(8)));
+  static const size_t sizes[] = {1, 7, 16, 64, 256, 4096};
+  static const int values[] = {0, 0x5a, 0xff};
+  size_t n, off, i;
+
+  /* every size, alignment and a few values, with guard bytes around */
+  for (n = 1; n <= 300; n++) {
+    for (off = 0; off < 8; off++) {
+      for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        memset(dst, 0xa5, sizeof(dst));
+        memset(ref, 0xa5, sizeof(ref));
+        assert(moth_memset(dst + off, values[i], n) == dst + off);
+        memset(ref + off, values[i], n);
+        assert(memcmp(dst, ref, sizeof(dst)) == 0);
+      }
+    }
+  }
+  printf("memset: results match\n");
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    n = sizes[i];
+    printf("%5zu bytes: byte loop %8.1f ns, aligned %8.1f ns, "
+           "misaligned %8.1f ns\n",
+           n, bench(byte_memset, dst, n), bench(moth_memset, dst, n),
+           bench(moth_memset, dst + 1, n));
+  }
+
+  return 0;
+}
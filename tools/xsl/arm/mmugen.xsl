@@ -35,11 +35,27 @@
     <xsl:text>#define PTE(paddr, cache, prot) ((uint32_t)((paddr) + (cache) + (prot) + DEFAULT_LVL2_ATTR))&#xa;</xsl:text>
     <xsl:text>#define FAULT() 0&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
+    <xsl:variable name="areas">
+      <xsl:apply-templates select="context" mode="chunk"/>
+    </xsl:variable>
+    <xsl:variable name="chunks">
+      <xsl:call-template name="share">
+        <xsl:with-param name="areas" select="$areas"/>
+      </xsl:call-template>
+    </xsl:variable>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
     <xsl:text> * Tables of the various contexts&#xa;</xsl:text>
     <xsl:text> * "One table for each context"&#xa;</xsl:text>
+    <xsl:text> * Identical level2 tables are only generated once and shared between&#xa;</xsl:text>
+    <xsl:text> * the contexts: </xsl:text>
+    <xsl:value-of select="count(ext:node-set($chunks)/chunk[owner = 'true'])"/>
+    <xsl:text> tables for </xsl:text>
+    <xsl:value-of select="count(ext:node-set($chunks)/chunk)"/>
+    <xsl:text> references&#xa;</xsl:text>
     <xsl:text> *****************************************************************************/&#xa;</xsl:text>
-    <xsl:apply-templates select="context" mode="level1"/>
+    <xsl:apply-templates select="context" mode="level1">
+      <xsl:with-param name="chunks" select="$chunks"/>
+    </xsl:apply-templates>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
     <xsl:text> * Main contexts table&#xa;</xsl:text>
@@ -73,15 +89,30 @@
     <xsl:text>_level1),&#xa;</xsl:text>
   </xsl:template>
 
-  <xsl:template match="context" mode="level1">
+  <xsl:template match="context" mode="pages">
     <xsl:variable name="tmp">
       <xsl:apply-templates select="virtual_ref"/>
     </xsl:variable>
+    <xsl:for-each select="ext:node-set($tmp)/virtual_page">
+      <xsl:sort select="virt" data-type="number"/>
+      <xsl:copy-of select="."/>
+    </xsl:for-each>
+  </xsl:template>
+
+  <xsl:template match="context" mode="chunk">
     <xsl:variable name="virtualMapping">
-      <xsl:for-each select="ext:node-set($tmp)/virtual_page">
-        <xsl:sort select="virt" data-type="number"/>
-        <xsl:copy-of select="."/>
-      </xsl:for-each>
+      <xsl:apply-templates select="." mode="pages"/>
+    </xsl:variable>
+    <xsl:call-template name="chunk">
+      <xsl:with-param name="pages" select="$virtualMapping"/>
+      <xsl:with-param name="name" select="@name"/>
+    </xsl:call-template>
+  </xsl:template>
+
+  <xsl:template match="context" mode="level1">
+    <xsl:param name="chunks"/>
+    <xsl:variable name="virtualMapping">
+      <xsl:apply-templates select="." mode="pages"/>
     </xsl:variable>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
@@ -93,6 +124,7 @@
     <xsl:call-template name="level2">
       <xsl:with-param name="pages" select="$virtualMapping"/>
       <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
     </xsl:call-template>
     <xsl:text>static uint32_t </xsl:text>
     <xsl:value-of select="@name"/>
@@ -102,40 +134,109 @@
     <xsl:call-template name="level1">
       <xsl:with-param name="pages" select="$virtualMapping"/>
       <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
     </xsl:call-template>
     <xsl:text>};&#xa;</xsl:text>
   </xsl:template>
 
-  <xsl:template name="level2">
+  <!-- List the 1MB areas holding at least one page. The signature
+       describes the level2 table content relative to the area base so
+       that identical tables can be found across contexts -->
+  <xsl:template name="chunk">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
     <xsl:if test="ext:node-set($pages)/virtual_page[1]">
-      <xsl:variable name="vaddress" select="(ext:node-set($pages)/virtual_page[1]/virt div 1048576) * 1048576"/>
+      <xsl:variable name="vaddress" select="floor(ext:node-set($pages)/virtual_page[1]/virt div 1048576) * 1048576"/>
       <xsl:variable name="nextaddress" select="$vaddress + 1048576"/>
-      <xsl:text>static uint32_t </xsl:text>
-      <xsl:value-of select="@name"/>
-      <xsl:text>_</xsl:text>
-      <xsl:call-template name="toHex">
-        <xsl:with-param name="num" select="$vaddress"/>
-      </xsl:call-template>
-      <xsl:text>_level2[MM_LVL2_ENTRIES_NBR]&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL2_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
-      <xsl:variable name="head">
+      <xsl:element name="chunk">
+        <xsl:element name="context">
+          <xsl:value-of select="$name"/>
+        </xsl:element>
+        <xsl:element name="base">
+          <xsl:value-of select="$vaddress"/>
+        </xsl:element>
+        <xsl:element name="sig">
+          <xsl:for-each select="ext:node-set($pages)/virtual_page[$nextaddress > virt][protection != 'fault']">
+            <xsl:value-of select="(virt - $vaddress) div 4096"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="phys"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="cache"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="protection"/>
+            <xsl:text>;</xsl:text>
+          </xsl:for-each>
+        </xsl:element>
+      </xsl:element>
+      <xsl:variable name="tail">
         <xsl:for-each select="ext:node-set($pages)/virtual_page">
-          <xsl:if test="$nextaddress > virt">
+          <xsl:if test="virt >=  $nextaddress">
             <xsl:copy-of select="."/>
           </xsl:if>
         </xsl:for-each>
       </xsl:variable>
-      <xsl:call-template name="level23">
-        <xsl:with-param name="pages" select="$head"/>
+      <xsl:call-template name="chunk">
+        <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
-        <xsl:with-param name="vaddress" select="$vaddress"/>
-        <xsl:with-param name="endaddress" select="$nextaddress"/>
       </xsl:call-template>
-      <xsl:text>};&#xa;</xsl:text>
-      <xsl:text>&#xa;</xsl:text>
+    </xsl:if>
+  </xsl:template>
+
+  <!-- The first area (in context order) with a given content owns the
+       table, all the following ones point to it -->
+  <xsl:template name="share">
+    <xsl:param name="areas"/>
+    <xsl:for-each select="ext:node-set($areas)/chunk">
+      <xsl:variable name="first" select="(preceding-sibling::chunk[sig = current()/sig] | .)[1]"/>
+      <xsl:element name="chunk">
+        <xsl:copy-of select="context | base"/>
+        <xsl:element name="owner">
+          <xsl:value-of select="count($first | .) = 1"/>
+        </xsl:element>
+        <xsl:element name="table">
+          <xsl:value-of select="$first/context"/>
+          <xsl:text>_</xsl:text>
+          <xsl:call-template name="toHex">
+            <xsl:with-param name="num" select="$first/base"/>
+          </xsl:call-template>
+        </xsl:element>
+      </xsl:element>
+    </xsl:for-each>
+  </xsl:template>
+
+  <xsl:template name="level2">
+    <xsl:param name="pages"/>
+    <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
+    <xsl:if test="ext:node-set($pages)/virtual_page[1]">
+      <xsl:variable name="vaddress" select="floor(ext:node-set($pages)/virtual_page[1]/virt div 1048576) * 1048576"/>
+      <xsl:variable name="nextaddress" select="$vaddress + 1048576"/>
+      <xsl:if test="ext:node-set($chunks)/chunk[context = $name][base = $vaddress][owner = 'true']">
+        <xsl:text>static uint32_t </xsl:text>
+        <xsl:value-of select="$name"/>
+        <xsl:text>_</xsl:text>
+        <xsl:call-template name="toHex">
+          <xsl:with-param name="num" select="$vaddress"/>
+        </xsl:call-template>
+        <xsl:text>_level2[MM_LVL2_ENTRIES_NBR]&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL2_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
+        <xsl:variable name="head">
+          <xsl:for-each select="ext:node-set($pages)/virtual_page">
+            <xsl:if test="$nextaddress > virt">
+              <xsl:copy-of select="."/>
+            </xsl:if>
+          </xsl:for-each>
+        </xsl:variable>
+        <xsl:call-template name="level23">
+          <xsl:with-param name="pages" select="$head"/>
+          <xsl:with-param name="name" select="$name"/>
+          <xsl:with-param name="vaddress" select="$vaddress"/>
+          <xsl:with-param name="endaddress" select="$nextaddress"/>
+        </xsl:call-template>
+        <xsl:text>};&#xa;</xsl:text>
+        <xsl:text>&#xa;</xsl:text>
+      </xsl:if>
       <xsl:variable name="tail">
         <xsl:for-each select="ext:node-set($pages)/virtual_page">
           <xsl:if test="virt >=  $nextaddress">
@@ -146,6 +247,7 @@
       <xsl:call-template name="level2">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
       </xsl:call-template>
     </xsl:if>
   </xsl:template>
@@ -214,6 +316,7 @@
   <xsl:template name="level1">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
     <xsl:param name="vaddress" select="0"/>
     <xsl:if test="4294967296 > $vaddress">
       <xsl:variable name="nextaddress" select="$vaddress + 1048576"/>
@@ -229,11 +332,7 @@
       <xsl:choose>
         <xsl:when test="$nextaddress > ext:node-set($pages)/virtual_page[1]/virt">
           <xsl:text>PTD(</xsl:text>
-          <xsl:value-of select="$name"/>
-          <xsl:text>_</xsl:text>
-          <xsl:call-template name="toHex">
-            <xsl:with-param name="num" select="ext:node-set($pages)/virtual_page[1]/virt"/>
-          </xsl:call-template>
+          <xsl:value-of select="ext:node-set($chunks)/chunk[context = $name][base = $vaddress]/table"/>
           <xsl:text>_level2),</xsl:text>
         </xsl:when>
         <xsl:otherwise>
@@ -251,6 +350,7 @@
       <xsl:call-template name="level1">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
         <xsl:with-param name="vaddress" select="$nextaddress"/>
       </xsl:call-template>
     </xsl:if>
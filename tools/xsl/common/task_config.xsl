@@ -5,6 +5,8 @@
 <xsl:template match="/">
   <xsl:apply-templates select="platform/contexts" mode="os_task_id"/>
   <xsl:apply-templates select="platform/contexts" mode="os_task_ro"/>
+  <xsl:apply-templates select="platform/contexts" mode="os_task_broadcast"/>
+  <xsl:apply-templates select="platform/contexts" mode="os_irq_owner"/>
 </xsl:template>
 
 <xsl:template match="contexts" mode="os_task_ro">
@@ -21,6 +23,62 @@
   <xsl:text>os_task_ro_t const os_task_ro[CONFIG_MAX_TASK_COUNT] = {&#xa;</xsl:text>
   <xsl:apply-templates select="context" mode="os_task_ro"/>
   <xsl:text>};&#xa;</xsl:text>
+  <xsl:text>&#xa;</xsl:text>
+  <xsl:text>_Static_assert(0</xsl:text>
+  <xsl:for-each select="context">
+    <xsl:text> + </xsl:text>
+    <xsl:apply-templates select="." mode="mbx_count"/>
+  </xsl:for-each>
+  <xsl:text> &lt;= CONFIG_MBX_POOL_COUNT,&#xa;</xsl:text>
+  <xsl:text>               "CONFIG_MBX_POOL_COUNT is too small for the task mbx");&#xa;</xsl:text>
+  <xsl:for-each select="context[mbx/count]">
+    <xsl:text>_Static_assert(</xsl:text>
+    <xsl:value-of select="mbx/count"/>
+    <xsl:text> &lt;= CONFIG_TASK_MBX_COUNT,&#xa;</xsl:text>
+    <xsl:text>               "mbx count of </xsl:text>
+    <xsl:value-of select="@name"/>
+    <xsl:text> is above CONFIG_TASK_MBX_COUNT");&#xa;</xsl:text>
+  </xsl:for-each>
+</xsl:template>
+
+<!-- mbx FIFO depth of a task (CONFIG_TASK_MBX_COUNT if not given) -->
+<xsl:template match="context" mode="mbx_count">
+  <xsl:choose>
+    <xsl:when test="mbx/count">
+      <xsl:value-of select="mbx/count"/>
+    </xsl:when>
+    <xsl:otherwise>
+      <xsl:text>CONFIG_TASK_MBX_COUNT</xsl:text>
+    </xsl:otherwise>
+  </xsl:choose>
+</xsl:template>
+
+<!-- mbx overflow policy of a task (reject if not given) -->
+<xsl:template match="context" mode="mbx_overflow">
+  <xsl:variable name="overflow" select="translate(normalize-space(mbx/overflow), 'abcdefghijklmnopqrstuvwxyz', 'ABCDEFGHIJKLMNOPQRSTUVWXYZ')"/>
+  <xsl:choose>
+    <xsl:when test="not(mbx/overflow) or $overflow = 'REJECT'">
+      <xsl:text>OS_MBX_OVERFLOW_REJECT</xsl:text>
+    </xsl:when>
+    <xsl:when test="$overflow = 'DROP_NEWEST'">
+      <xsl:text>OS_MBX_OVERFLOW_DROP_NEWEST</xsl:text>
+    </xsl:when>
+    <xsl:when test="$overflow = 'DROP_OLDEST'">
+      <xsl:text>OS_MBX_OVERFLOW_DROP_OLDEST</xsl:text>
+    </xsl:when>
+    <xsl:when test="$overflow = 'COALESCE'">
+      <xsl:text>OS_MBX_OVERFLOW_COALESCE</xsl:text>
+    </xsl:when>
+    <xsl:otherwise>
+      <xsl:message terminate="yes">
+        <xsl:text>Error: unknown mbx overflow policy '</xsl:text>
+        <xsl:value-of select="mbx/overflow"/>
+        <xsl:text>' for </xsl:text>
+        <xsl:value-of select="@name"/>
+        <xsl:text> (reject, drop_newest, drop_oldest or coalesce)</xsl:text>
+      </xsl:message>
+    </xsl:otherwise>
+  </xsl:choose>
 </xsl:template>
 
 <xsl:template match="context" mode="os_task_ro">
@@ -30,24 +88,67 @@
   <xsl:text>    </xsl:text>
   <xsl:value-of select="priority"/>
   <xsl:text>, /* priority */&#xa;</xsl:text>
-  <xsl:text>    0</xsl:text>
-  <xsl:apply-templates select="mbx" mode="os_task_ro"/>
-  <xsl:text>, /* mbx_permission */&#xa;</xsl:text>
+  <xsl:text>    </xsl:text>
+  <xsl:apply-templates select="." mode="mbx_count"/>
+  <xsl:text>, /* mbx_count */&#xa;</xsl:text>
+  <xsl:text>    </xsl:text>
+  <xsl:apply-templates select="." mode="mbx_overflow"/>
+  <xsl:text>, /* mbx_overflow */&#xa;</xsl:text>
+  <xsl:text>    {{</xsl:text>
+  <xsl:call-template name="mbx_mask_word">
+    <xsl:with-param name="word" select="0"/>
+    <xsl:with-param name="tasks" select="mbx/permission"/>
+  </xsl:call-template>
+  <xsl:text> }}, /* mbx_permission */&#xa;</xsl:text>
+  <xsl:text>    {{</xsl:text>
+  <xsl:call-template name="mbx_mask_word">
+    <xsl:with-param name="word" select="0"/>
+    <xsl:with-param name="tasks" select="mbx/urgent"/>
+  </xsl:call-template>
+  <xsl:text> }}, /* mbx_urgent */&#xa;</xsl:text>
   <xsl:apply-templates select="virtual_ref" mode="os_task_ro"/>
   <xsl:text>  },&#xa;</xsl:text>
 </xsl:template>
 
-<xsl:template match="mbx" mode="os_task_ro">
-  <xsl:apply-templates select="permission" mode="os_task_ro"/>
+<!-- One 32 bits word of the mbx mask for each group of 32 tasks -->
+<xsl:template name="mbx_mask_word">
+  <xsl:param name="word"/>
+  <xsl:param name="tasks"/>
+  <xsl:if test="$word != 0">
+    <xsl:text>,</xsl:text>
+  </xsl:if>
+  <xsl:text> 0</xsl:text>
+  <xsl:apply-templates select="$tasks" mode="os_task_ro">
+    <xsl:with-param name="word" select="$word"/>
+  </xsl:apply-templates>
+  <xsl:if test="($word + 1) * 32 &lt; count(../context)">
+    <xsl:call-template name="mbx_mask_word">
+      <xsl:with-param name="word" select="$word + 1"/>
+      <xsl:with-param name="tasks" select="$tasks"/>
+    </xsl:call-template>
+  </xsl:if>
 </xsl:template>
 
-<xsl:template match="permission" mode="os_task_ro">
+<xsl:template match="permission | urgent" mode="os_task_ro">
+  <xsl:param name="word"/>
   <xsl:variable name="smallcase" select="'abcdefghijklmnopqrstuvwxyz'" />
   <xsl:variable name="uppercase" select="'ABCDEFGHIJKLMNOPQRSTUVWXYZ'" />
   <xsl:variable name="task" select="."/>
-  <xsl:text> | 1 &lt;&lt; OS_</xsl:text>
+  <!-- a permission with an "if" attribute only exists in the builds with
+       this configuration option set -->
+  <xsl:if test="@if">
+    <xsl:text>&#xa;#if defined(</xsl:text>
+    <xsl:value-of select="@if"/>
+    <xsl:text>)&#xa;   </xsl:text>
+  </xsl:if>
+  <xsl:text> | OS_MBX_MASK_BIT(</xsl:text>
+  <xsl:value-of select="$word"/>
+  <xsl:text>, OS_</xsl:text>
   <xsl:value-of select="translate($task, $smallcase, $uppercase)" />
-  <xsl:text>_TASK_ID</xsl:text>
+  <xsl:text>_TASK_ID)</xsl:text>
+  <xsl:if test="@if">
+    <xsl:text>&#xa;#endif&#xa;   </xsl:text>
+  </xsl:if>
 </xsl:template>
 
 <xsl:template match="virtual_ref" mode="os_task_ro">
@@ -63,6 +164,8 @@
     <xsl:apply-templates select="virtual_map[@name = 'bss']" mode="os_task_ro"/>
     <xsl:text>    </xsl:text>
     <xsl:apply-templates select="virtual_map[@name = 'stack']" mode="os_task_ro"/>
+    <xsl:text>    </xsl:text>
+    <xsl:apply-templates select="virtual_map[@name = 'rodata']" mode="os_task_ro"/>
   </xsl:if>
 </xsl:template>
 
@@ -76,6 +179,96 @@
   <xsl:text> */&#xa;</xsl:text>
 </xsl:template>
 
+<xsl:template match="contexts" mode="os_task_broadcast">
+  <xsl:text>&#xa;</xsl:text>
+  <xsl:text>__attribute__((section(".rodata")))&#xa;</xsl:text>
+  <xsl:text>os_task_broadcast_t const os_task_broadcast[CONFIG_MAX_TASK_COUNT] = {&#xa;</xsl:text>
+  <xsl:apply-templates select="context" mode="os_task_broadcast"/>
+  <xsl:text>};&#xa;</xsl:text>
+</xsl:template>
+
+<!-- List the tasks accepting mbx from this task by decreasing priority -->
+<xsl:template match="context" mode="os_task_broadcast">
+  <xsl:variable name="smallcase" select="'abcdefghijklmnopqrstuvwxyz'" />
+  <xsl:variable name="uppercase" select="'ABCDEFGHIJKLMNOPQRSTUVWXYZ'" />
+  <xsl:variable name="sender" select="@name"/>
+  <!-- conditional permissions (see above) do not receive broadcasts -->
+  <xsl:variable name="receivers" select="../context[mbx/permission[not(@if)] = $sender]"/>
+  <xsl:text>  { /* </xsl:text>
+  <xsl:value-of select="@name"/>
+  <xsl:text> */&#xa;</xsl:text>
+  <xsl:text>    </xsl:text>
+  <xsl:value-of select="count($receivers)"/>
+  <xsl:text>, /* receiver count */&#xa;</xsl:text>
+  <xsl:text>    {</xsl:text>
+  <xsl:for-each select="$receivers">
+    <xsl:sort select="priority" data-type="number" order="descending"/>
+    <xsl:text> OS_</xsl:text>
+    <xsl:value-of select="translate(@name, $smallcase, $uppercase)" />
+    <xsl:text>_TASK_ID,</xsl:text>
+  </xsl:for-each>
+  <xsl:if test="not($receivers)">
+    <xsl:text> OS_TASK_ID_NONE</xsl:text>
+  </xsl:if>
+  <xsl:text> }, /* receivers */&#xa;</xsl:text>
+  <xsl:text>  },&#xa;</xsl:text>
+</xsl:template>
+
+<xsl:template match="contexts" mode="os_irq_owner">
+  <xsl:text>&#xa;</xsl:text>
+  <xsl:text>__attribute__((section(".rodata")))&#xa;</xsl:text>
+  <xsl:text>os_task_id_t const os_irq_owner[OS_IRQ_MAX] = {&#xa;</xsl:text>
+  <xsl:call-template name="irq_owner">
+    <xsl:with-param name="irq" select="0"/>
+  </xsl:call-template>
+  <xsl:text>};&#xa;</xsl:text>
+  <xsl:text>&#xa;</xsl:text>
+  <xsl:text>_Static_assert(OS_IRQ_MAX == 32, "task_config.xsl expects 32 IRQ lines");&#xa;</xsl:text>
+  <xsl:for-each select="context/irq[not(. &gt;= 0 and . &lt; 32)]">
+    <xsl:message terminate="yes">
+      <xsl:text>Error: IRQ line '</xsl:text>
+      <xsl:value-of select="."/>
+      <xsl:text>' of </xsl:text>
+      <xsl:value-of select="../@name"/>
+      <xsl:text> is out of range</xsl:text>
+    </xsl:message>
+  </xsl:for-each>
+</xsl:template>
+
+<!-- Task the interrupt line is routed to by the kernel (one line per IRQ) -->
+<xsl:template name="irq_owner">
+  <xsl:param name="irq"/>
+  <xsl:variable name="smallcase" select="'abcdefghijklmnopqrstuvwxyz'" />
+  <xsl:variable name="uppercase" select="'ABCDEFGHIJKLMNOPQRSTUVWXYZ'" />
+  <xsl:variable name="owner" select="context[irq = $irq]"/>
+  <xsl:if test="count($owner) &gt; 1">
+    <xsl:message terminate="yes">
+      <xsl:text>Error: IRQ line </xsl:text>
+      <xsl:value-of select="$irq"/>
+      <xsl:text> is routed to more than one task</xsl:text>
+    </xsl:message>
+  </xsl:if>
+  <xsl:text>  </xsl:text>
+  <xsl:choose>
+    <xsl:when test="$owner">
+      <xsl:text>OS_</xsl:text>
+      <xsl:value-of select="translate($owner/@name, $smallcase, $uppercase)" />
+      <xsl:text>_TASK_ID</xsl:text>
+    </xsl:when>
+    <xsl:otherwise>
+      <xsl:text>OS_TASK_ID_NONE</xsl:text>
+    </xsl:otherwise>
+  </xsl:choose>
+  <xsl:text>, /* </xsl:text>
+  <xsl:value-of select="$irq"/>
+  <xsl:text> */&#xa;</xsl:text>
+  <xsl:if test="$irq + 1 &lt; 32">
+    <xsl:call-template name="irq_owner">
+      <xsl:with-param name="irq" select="$irq + 1"/>
+    </xsl:call-template>
+  </xsl:if>
+</xsl:template>
+
 <xsl:template match="contexts" mode="os_task_id">
   <xsl:document href="os_task_id.h" method="text">
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
@@ -88,24 +88,42 @@
       <xsl:with-param name="num" select="$paddress"/>
     </xsl:call-template>
   </xsl:variable>
+  <xsl:variable name="data_image" select="../@name != 'kernel' and ../virtual_map[@name = 'rodata'] and ../virtual_map[@name = 'bss']"/>
   <xsl:if test="$decpaddress > 0">
+    <xsl:if test="$data_image and @name = 'bss'">
+      <xsl:apply-templates select="." mode="data_image"/>
+    </xsl:if>
     <xsl:text>  .</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text> </xsl:text>
     <xsl:apply-templates select="." mode="vaddress"/>
+    <xsl:if test="$data_image and @name = 'bss'">
+      <xsl:text> + SIZEOF(.data)</xsl:text>
+    </xsl:if>
     <xsl:text> : AT (</xsl:text>
     <xsl:apply-templates select="." mode="paddress"/>
+    <xsl:if test="$data_image and @name = 'bss'">
+      <xsl:text> + SIZEOF(.data)</xsl:text>
+    </xsl:if>
     <xsl:text>)&#xa;</xsl:text>
     <xsl:text>  {&#xa;</xsl:text>
     <xsl:text>    __</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text>_begin = .;&#xa;</xsl:text>
+    <xsl:if test="$data_image and @name = 'rodata'">
+      <xsl:text>    LONG(__data_image - __rodata_begin) /* .data image offset */&#xa;</xsl:text>
+      <xsl:text>    LONG(__data_end - __data_begin) /* .data image size */&#xa;</xsl:text>
+    </xsl:if>
     <xsl:text>    *(.</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text>.entry)&#xa;</xsl:text>
     <xsl:text>    *(.</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text>*)&#xa;</xsl:text>
+    <xsl:if test="$data_image and @name = 'rodata'">
+      <xsl:text>    . = ALIGN(8);&#xa;</xsl:text>
+      <xsl:text>    __data_image = .;&#xa;</xsl:text>
+    </xsl:if>
     <xsl:text>    __</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text>_end = </xsl:text>
@@ -114,9 +132,38 @@
     <xsl:text>  } ></xsl:text>
     <xsl:value-of select="./../@name"/>
     <xsl:text> =00&#xa;</xsl:text>
+    <xsl:if test="$data_image and @name = 'bss'">
+      <xsl:text>  ASSERT(SIZEOF(.data) + SIZEOF(.bss) &lt;= </xsl:text>
+      <xsl:apply-templates select="." mode="size"/>
+      <xsl:text>, ".data and .bss do not fit in the bss segment")&#xa;</xsl:text>
+    </xsl:if>
   </xsl:if>
 </xsl:template>
 
+<!--
+  The initialized .data of a task is linked at the start of its bss
+  segment and loaded right after its rodata. The kernel copies this
+  pristine image back each time the task is (re)started. The header at
+  the start of rodata gives the image offset and size.
+-->
+<xsl:template match="virtual_map" mode="data_image">
+  <xsl:variable name="rodata" select="../virtual_map[@name = 'rodata']"/>
+  <xsl:text>  .data </xsl:text>
+  <xsl:apply-templates select="." mode="vaddress"/>
+  <xsl:text> : AT (LOADADDR(.rodata) + SIZEOF(.rodata))&#xa;</xsl:text>
+  <xsl:text>  {&#xa;</xsl:text>
+  <xsl:text>    __data_begin = .;&#xa;</xsl:text>
+  <xsl:text>    *(.data*)&#xa;</xsl:text>
+  <xsl:text>    . = ALIGN(8);&#xa;</xsl:text>
+  <xsl:text>    __data_end = .;&#xa;</xsl:text>
+  <xsl:text>  } ></xsl:text>
+  <xsl:value-of select="./../@name"/>
+  <xsl:text>&#xa;</xsl:text>
+  <xsl:text>  ASSERT(SIZEOF(.rodata) + SIZEOF(.data) &lt;= </xsl:text>
+  <xsl:apply-templates select="$rodata" mode="size"/>
+  <xsl:text>, ".data image does not fit in the rodata segment")&#xa;</xsl:text>
+</xsl:template>
+
 <xsl:template match="virtual_map" mode="application">
   <xsl:variable name="paddress">
     <xsl:apply-templates select="." mode="paddress"/>
@@ -147,6 +194,11 @@
     <xsl:text>.</xsl:text>
     <xsl:value-of select="@name"/>
     <xsl:text>*)&#xa;</xsl:text>
+    <xsl:if test="@name = 'rodata'">
+      <xsl:text>    *(.</xsl:text>
+      <xsl:value-of select="./../@name"/>
+      <xsl:text>.data) /* .data image */&#xa;</xsl:text>
+    </xsl:if>
     <xsl:text>    __</xsl:text>
     <xsl:value-of select="./../@name"/>
     <xsl:text>_</xsl:text>
@@ -27,11 +27,27 @@
     <xsl:text>#define PTE(paddr, cache, prot) ((((paddr) >> 4) &amp; 0xffffff00) | (cache) | (prot) | MM_ET_PTE)&#xa;</xsl:text>
     <xsl:text>#define FAULT() 0&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
+    <xsl:variable name="areas">
+      <xsl:apply-templates select="context" mode="chunk"/>
+    </xsl:variable>
+    <xsl:variable name="chunks">
+      <xsl:call-template name="share">
+        <xsl:with-param name="areas" select="$areas"/>
+      </xsl:call-template>
+    </xsl:variable>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
     <xsl:text> * Tables of the various contexts&#xa;</xsl:text>
     <xsl:text> * "One table for each context"&#xa;</xsl:text>
+    <xsl:text> * Identical level2/level3 tables are only generated once and shared&#xa;</xsl:text>
+    <xsl:text> * between the contexts: </xsl:text>
+    <xsl:value-of select="count(ext:node-set($chunks)/chunk[large = 'false'][owner = 'true'])"/>
+    <xsl:text> tables for </xsl:text>
+    <xsl:value-of select="count(ext:node-set($chunks)/chunk[large = 'false'])"/>
+    <xsl:text> references&#xa;</xsl:text>
     <xsl:text> *****************************************************************************/&#xa;</xsl:text>
-    <xsl:apply-templates select="context" mode="level1"/>
+    <xsl:apply-templates select="context" mode="level1">
+      <xsl:with-param name="chunks" select="$chunks"/>
+    </xsl:apply-templates>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
     <xsl:text> * Main contexts table&#xa;</xsl:text>
@@ -54,32 +70,41 @@
     <xsl:text> * before using them.&#xa;</xsl:text>
     <xsl:text> *****************************************************************************/&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
+    <xsl:text>static void mmu_table_ptd_init(uint32_t *table, uint32_t entries)&#xa;</xsl:text>
+    <xsl:text>{&#xa;</xsl:text>
+    <xsl:text>  register uint32_t i;&#xa;</xsl:text>
+    <xsl:text>&#xa;</xsl:text>
+    <xsl:text>  for (i = 0; entries > i; i++) {&#xa;</xsl:text>
+    <xsl:text>    if (table[i] &amp; MM_ET_PTD) {&#xa;</xsl:text>
+    <xsl:text>      table[i] = ((table[i] >> 4) &amp; 0xfffffff0) | MM_ET_PTD;&#xa;</xsl:text>
+    <xsl:text>    }&#xa;</xsl:text>
+    <xsl:text>  }&#xa;</xsl:text>
+    <xsl:text>}&#xa;</xsl:text>
+    <xsl:text>&#xa;</xsl:text>
+    <xsl:text>/*&#xa;</xsl:text>
+    <xsl:text> * level2 tables may be shared between contexts. So each table is&#xa;</xsl:text>
+    <xsl:text> * reformatted once from its own symbol rather than by walking the&#xa;</xsl:text>
+    <xsl:text> * context trees.&#xa;</xsl:text>
+    <xsl:text> */&#xa;</xsl:text>
     <xsl:text>void os_arch_mmu_table_init(void)&#xa;</xsl:text>
     <xsl:text>{&#xa;</xsl:text>
-    <xsl:text>  register uint32_t i, j, k;&#xa;</xsl:text>
     <xsl:text>  static uint32_t mmu_table_init_done = 0;&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>  if (mmu_table_init_done) {&#xa;</xsl:text>
     <xsl:text>    return;&#xa;</xsl:text>
     <xsl:text>  }&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
-    <xsl:text>  for (i = 0; MM_LVL0_CTX_NBR > i; i++) {&#xa;</xsl:text>
-    <xsl:text>    if (mmu_entry[i] &amp; MM_ET_PTD) {&#xa;</xsl:text>
-    <xsl:text>      uint32_t *ptr1 = (uint32_t *)(mmu_entry[i] &amp; 0xffffff00);&#xa;</xsl:text>
-    <xsl:text>      for (j = 0; MM_LVL1_ENTRIES_NBR > j; j++) {&#xa;</xsl:text>
-    <xsl:text>        if (ptr1[j] &amp; MM_ET_PTD) {&#xa;</xsl:text>
-    <xsl:text>          uint32_t *ptr2 = (uint32_t *)(ptr1[j] &amp; 0xffffff00);&#xa;</xsl:text>
-    <xsl:text>          for (k = 0; MM_LVL2_ENTRIES_NBR > k; k++) {&#xa;</xsl:text>
-    <xsl:text>            if (ptr2[k] &amp; MM_ET_PTD) {&#xa;</xsl:text>
-    <xsl:text>              ptr2[k] = ((ptr2[k] >> 4) &amp; 0xfffffff0) | MM_ET_PTD;&#xa;</xsl:text>
-    <xsl:text>            }&#xa;</xsl:text>
-    <xsl:text>          }&#xa;</xsl:text>
-    <xsl:text>          ptr1[j] = ((ptr1[j] >> 4) &amp; 0xfffffff0) | MM_ET_PTD;&#xa;</xsl:text>
-    <xsl:text>        }&#xa;</xsl:text>
-    <xsl:text>      }&#xa;</xsl:text>
-    <xsl:text>      mmu_entry[i] = ((mmu_entry[i] >> 4) &amp; 0xfffffff0) | MM_ET_PTD;&#xa;</xsl:text>
-    <xsl:text>    }&#xa;</xsl:text>
-    <xsl:text>  }&#xa;</xsl:text>
+    <xsl:for-each select="ext:node-set($chunks)/chunk[size = 16777216][large = 'false'][owner = 'true']">
+      <xsl:text>  mmu_table_ptd_init(</xsl:text>
+      <xsl:value-of select="table"/>
+      <xsl:text>_level2, MM_LVL2_ENTRIES_NBR);&#xa;</xsl:text>
+    </xsl:for-each>
+    <xsl:for-each select="context">
+      <xsl:text>  mmu_table_ptd_init(</xsl:text>
+      <xsl:value-of select="@name"/>
+      <xsl:text>_level1, MM_LVL1_ENTRIES_NBR);&#xa;</xsl:text>
+    </xsl:for-each>
+    <xsl:text>  mmu_table_ptd_init(mmu_entry, MM_LVL0_CTX_NBR);&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>  mmu_table_init_done = 1;&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
@@ -97,15 +122,36 @@
     <xsl:text>_level1),&#xa;</xsl:text>
   </xsl:template>
 
-  <xsl:template match="context" mode="level1">
+  <xsl:template match="context" mode="pages">
     <xsl:variable name="tmp">
       <xsl:apply-templates select="virtual_ref"/>
     </xsl:variable>
+    <xsl:for-each select="ext:node-set($tmp)/virtual_page">
+      <xsl:sort select="virt" data-type="number"/>
+      <xsl:copy-of select="."/>
+    </xsl:for-each>
+  </xsl:template>
+
+  <xsl:template match="context" mode="chunk">
+    <xsl:variable name="virtualMapping">
+      <xsl:apply-templates select="." mode="pages"/>
+    </xsl:variable>
+    <xsl:call-template name="chunk">
+      <xsl:with-param name="pages" select="$virtualMapping"/>
+      <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="size" select="262144"/>
+    </xsl:call-template>
+    <xsl:call-template name="chunk">
+      <xsl:with-param name="pages" select="$virtualMapping"/>
+      <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="size" select="16777216"/>
+    </xsl:call-template>
+  </xsl:template>
+
+  <xsl:template match="context" mode="level1">
+    <xsl:param name="chunks"/>
     <xsl:variable name="virtualMapping">
-      <xsl:for-each select="ext:node-set($tmp)/virtual_page">
-        <xsl:sort select="virt" data-type="number"/>
-        <xsl:copy-of select="."/>
-      </xsl:for-each>
+      <xsl:apply-templates select="." mode="pages"/>
     </xsl:variable>
     <xsl:text>&#xa;</xsl:text>
     <xsl:text>/*****************************************************************************&#xa;</xsl:text>
@@ -113,15 +159,22 @@
     <xsl:value-of select="@name"/>
     <xsl:text>" partition </xsl:text>
     <xsl:text>&#xa;</xsl:text>
+    <xsl:call-template name="report">
+      <xsl:with-param name="pages" select="$virtualMapping"/>
+      <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
+    </xsl:call-template>
     <xsl:text> *****************************************************************************/&#xa;</xsl:text>
     <xsl:text>&#xa;</xsl:text>
     <xsl:call-template name="level3">
       <xsl:with-param name="pages" select="$virtualMapping"/>
       <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
     </xsl:call-template>
     <xsl:call-template name="level2">
       <xsl:with-param name="pages" select="$virtualMapping"/>
       <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
     </xsl:call-template>
     <xsl:text>static uint32_t </xsl:text>
     <xsl:value-of select="@name"/>
@@ -131,25 +184,25 @@
     <xsl:call-template name="level1">
       <xsl:with-param name="pages" select="$virtualMapping"/>
       <xsl:with-param name="name" select="@name"/>
+      <xsl:with-param name="chunks" select="$chunks"/>
     </xsl:call-template>
     <xsl:text>};&#xa;</xsl:text>
   </xsl:template>
 
-  <xsl:template name="level3">
+  <!-- List the 256KB (or 16MB) areas holding at least one page. An area
+       can be mapped by a single level-2 (or level-1) PTE when all its
+       pages are present, physically contiguous from an aligned address
+       and share the same protection and cache attributes. The signature
+       describes the table content relative to the area base so that
+       identical tables can be found across contexts -->
+  <xsl:template name="chunk">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
+    <xsl:param name="size"/>
     <xsl:if test="ext:node-set($pages)/virtual_page[1]">
-      <xsl:variable name="vaddress" select="(ext:node-set($pages)/virtual_page[1]/virt div 262144) * 262144"/>
-      <xsl:variable name="nextaddress" select="$vaddress + 262144"/>
-      <xsl:text>static uint32_t </xsl:text>
-      <xsl:value-of select="@name"/>
-      <xsl:text>_</xsl:text>
-      <xsl:call-template name="toHex">
-        <xsl:with-param name="num" select="$vaddress"/>
-      </xsl:call-template>
-      <xsl:text>_level3[MM_LVL3_ENTRIES_NBR]&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL3_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
+      <xsl:variable name="first" select="ext:node-set($pages)/virtual_page[1]"/>
+      <xsl:variable name="vaddress" select="floor($first/virt div $size) * $size"/>
+      <xsl:variable name="nextaddress" select="$vaddress + $size"/>
       <xsl:variable name="head">
         <xsl:for-each select="ext:node-set($pages)/virtual_page">
           <xsl:if test="$nextaddress > virt">
@@ -157,14 +210,141 @@
           </xsl:if>
         </xsl:for-each>
       </xsl:variable>
-      <xsl:call-template name="level33">
-        <xsl:with-param name="pages" select="$head"/>
+      <xsl:variable name="delta" select="$first/phys - $first/virt"/>
+      <xsl:element name="chunk">
+        <xsl:element name="context">
+          <xsl:value-of select="$name"/>
+        </xsl:element>
+        <xsl:element name="base">
+          <xsl:value-of select="$vaddress"/>
+        </xsl:element>
+        <xsl:element name="size">
+          <xsl:value-of select="$size"/>
+        </xsl:element>
+        <xsl:element name="large">
+          <xsl:value-of select="count(ext:node-set($head)/virtual_page) = $size div 4096
+                                and $first/virt = $vaddress
+                                and $first/phys mod $size = 0
+                                and $first/protection != 'fault'
+                                and not(ext:node-set($head)/virtual_page[phys - virt != $delta
+                                                                       or protection != $first/protection
+                                                                       or cache != $first/cache])"/>
+        </xsl:element>
+        <xsl:element name="sig">
+          <xsl:for-each select="ext:node-set($head)/virtual_page[protection != 'fault']">
+            <xsl:value-of select="(virt - $vaddress) div 4096"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="phys"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="cache"/>
+            <xsl:text>:</xsl:text>
+            <xsl:value-of select="protection"/>
+            <xsl:text>;</xsl:text>
+          </xsl:for-each>
+        </xsl:element>
+      </xsl:element>
+      <xsl:variable name="tail">
+        <xsl:for-each select="ext:node-set($pages)/virtual_page">
+          <xsl:if test="virt >=  $nextaddress">
+            <xsl:copy-of select="."/>
+          </xsl:if>
+        </xsl:for-each>
+      </xsl:variable>
+      <xsl:call-template name="chunk">
+        <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
-        <xsl:with-param name="vaddress" select="$vaddress"/>
-        <xsl:with-param name="endaddress" select="$nextaddress"/>
+        <xsl:with-param name="size" select="$size"/>
       </xsl:call-template>
-      <xsl:text>};&#xa;</xsl:text>
-      <xsl:text> &#xa;</xsl:text>
+    </xsl:if>
+  </xsl:template>
+
+  <!-- The first area (in context order) with a given content owns the
+       table, all the following ones point to it -->
+  <xsl:template name="share">
+    <xsl:param name="areas"/>
+    <xsl:for-each select="ext:node-set($areas)/chunk">
+      <xsl:variable name="first" select="(preceding-sibling::chunk[size = current()/size][sig = current()/sig] | .)[1]"/>
+      <xsl:element name="chunk">
+        <xsl:copy-of select="context | base | size | large"/>
+        <xsl:element name="owner">
+          <xsl:value-of select="count($first | .) = 1"/>
+        </xsl:element>
+        <xsl:element name="table">
+          <xsl:value-of select="$first/context"/>
+          <xsl:text>_</xsl:text>
+          <xsl:call-template name="toHex">
+            <xsl:with-param name="num" select="$first/base"/>
+          </xsl:call-template>
+        </xsl:element>
+      </xsl:element>
+    </xsl:for-each>
+  </xsl:template>
+
+  <!-- Table memory and TLB entries needed by the partition compared to
+       a mapping made of 4KB pages only -->
+  <xsl:template name="report">
+    <xsl:param name="pages"/>
+    <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
+    <xsl:variable name="all" select="count(ext:node-set($chunks)/chunk[context = $name])"/>
+    <xsl:variable name="l2" select="count(ext:node-set($chunks)/chunk[context = $name][size = 262144][large = 'true'])"/>
+    <xsl:variable name="l1" select="count(ext:node-set($chunks)/chunk[context = $name][size = 16777216][large = 'true'])"/>
+    <xsl:variable name="shared" select="count(ext:node-set($chunks)/chunk[context = $name][large = 'false'][owner = 'false'])"/>
+    <xsl:variable name="mapped" select="count(ext:node-set($pages)/virtual_page[protection != 'fault'])"/>
+    <xsl:text> * </xsl:text>
+    <xsl:value-of select="$l1"/>
+    <xsl:text> x 16MB and </xsl:text>
+    <xsl:value-of select="$l2 - 64 * $l1"/>
+    <xsl:text> x 256KB large pages&#xa;</xsl:text>
+    <xsl:text> * level2/level3 tables: </xsl:text>
+    <xsl:value-of select="$all - $l2 - $l1 - $shared"/>
+    <xsl:text> + </xsl:text>
+    <xsl:value-of select="$shared"/>
+    <xsl:text> shared (</xsl:text>
+    <xsl:value-of select="$all"/>
+    <xsl:text> with 4KB pages only), </xsl:text>
+    <xsl:value-of select="($l2 + $l1 + $shared) * 64 * 4"/>
+    <xsl:text> bytes saved&#xa;</xsl:text>
+    <xsl:text> * TLB entries: </xsl:text>
+    <xsl:value-of select="$mapped - 63 * $l2 - 63 * $l1"/>
+    <xsl:text> (</xsl:text>
+    <xsl:value-of select="$mapped"/>
+    <xsl:text> with 4KB pages only)&#xa;</xsl:text>
+  </xsl:template>
+
+  <xsl:template name="level3">
+    <xsl:param name="pages"/>
+    <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
+    <xsl:if test="ext:node-set($pages)/virtual_page[1]">
+      <xsl:variable name="vaddress" select="floor(ext:node-set($pages)/virtual_page[1]/virt div 262144) * 262144"/>
+      <xsl:variable name="nextaddress" select="$vaddress + 262144"/>
+      <xsl:if test="ext:node-set($chunks)/chunk[context = $name][size = 262144][base = $vaddress][large = 'false'][owner = 'true']">
+        <xsl:text>static uint32_t </xsl:text>
+        <xsl:value-of select="$name"/>
+        <xsl:text>_</xsl:text>
+        <xsl:call-template name="toHex">
+          <xsl:with-param name="num" select="$vaddress"/>
+        </xsl:call-template>
+        <xsl:text>_level3[MM_LVL3_ENTRIES_NBR]&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL3_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
+        <xsl:variable name="head">
+          <xsl:for-each select="ext:node-set($pages)/virtual_page">
+            <xsl:if test="$nextaddress > virt">
+              <xsl:copy-of select="."/>
+            </xsl:if>
+          </xsl:for-each>
+        </xsl:variable>
+        <xsl:call-template name="level33">
+          <xsl:with-param name="pages" select="$head"/>
+          <xsl:with-param name="name" select="$name"/>
+          <xsl:with-param name="vaddress" select="$vaddress"/>
+          <xsl:with-param name="endaddress" select="$nextaddress"/>
+        </xsl:call-template>
+        <xsl:text>};&#xa;</xsl:text>
+        <xsl:text> &#xa;</xsl:text>
+      </xsl:if>
       <xsl:variable name="tail">
         <xsl:for-each select="ext:node-set($pages)/virtual_page">
           <xsl:if test="virt >=  $nextaddress">
@@ -175,6 +355,7 @@
       <xsl:call-template name="level3">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
       </xsl:call-template>
     </xsl:if>
   </xsl:template>
@@ -243,33 +424,37 @@
   <xsl:template name="level2">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
     <xsl:if test="ext:node-set($pages)/virtual_page[1]">
-      <xsl:variable name="vaddress" select="(ext:node-set($pages)/virtual_page[1]/virt div 16777216) * 16777216"/>
+      <xsl:variable name="vaddress" select="floor(ext:node-set($pages)/virtual_page[1]/virt div 16777216) * 16777216"/>
       <xsl:variable name="nextaddress" select="$vaddress + 16777216"/>
-      <xsl:text>static uint32_t </xsl:text>
-      <xsl:value-of select="@name"/>
-      <xsl:text>_</xsl:text>
-      <xsl:call-template name="toHex">
-        <xsl:with-param name="num" select="$vaddress"/>
-      </xsl:call-template>
-      <xsl:text>_level2[MM_LVL2_ENTRIES_NBR]&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
-      <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL2_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
-      <xsl:variable name="head">
-        <xsl:for-each select="ext:node-set($pages)/virtual_page">
-          <xsl:if test="$nextaddress > virt">
-            <xsl:copy-of select="."/>
-          </xsl:if>
-        </xsl:for-each>
-      </xsl:variable>
-      <xsl:call-template name="level23">
-        <xsl:with-param name="pages" select="$head"/>
-        <xsl:with-param name="name" select="$name"/>
-        <xsl:with-param name="vaddress" select="$vaddress"/>
-        <xsl:with-param name="endaddress" select="$nextaddress"/>
-      </xsl:call-template>
-      <xsl:text>};&#xa;</xsl:text>
-      <xsl:text>&#xa;</xsl:text>
+      <xsl:if test="ext:node-set($chunks)/chunk[context = $name][size = 16777216][base = $vaddress][large = 'false'][owner = 'true']">
+        <xsl:text>static uint32_t </xsl:text>
+        <xsl:value-of select="$name"/>
+        <xsl:text>_</xsl:text>
+        <xsl:call-template name="toHex">
+          <xsl:with-param name="num" select="$vaddress"/>
+        </xsl:call-template>
+        <xsl:text>_level2[MM_LVL2_ENTRIES_NBR]&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((section(".mmutable")))&#xa;</xsl:text>
+        <xsl:text>&#x9;__attribute__ ((aligned (MM_LVL2_ENTRIES_NBR * sizeof(uint32_t)))) = {&#xa;</xsl:text>
+        <xsl:variable name="head">
+          <xsl:for-each select="ext:node-set($pages)/virtual_page">
+            <xsl:if test="$nextaddress > virt">
+              <xsl:copy-of select="."/>
+            </xsl:if>
+          </xsl:for-each>
+        </xsl:variable>
+        <xsl:call-template name="level23">
+          <xsl:with-param name="pages" select="$head"/>
+          <xsl:with-param name="name" select="$name"/>
+          <xsl:with-param name="chunks" select="$chunks"/>
+          <xsl:with-param name="vaddress" select="$vaddress"/>
+          <xsl:with-param name="endaddress" select="$nextaddress"/>
+        </xsl:call-template>
+        <xsl:text>};&#xa;</xsl:text>
+        <xsl:text>&#xa;</xsl:text>
+      </xsl:if>
       <xsl:variable name="tail">
         <xsl:for-each select="ext:node-set($pages)/virtual_page">
           <xsl:if test="virt >=  $nextaddress">
@@ -280,6 +465,7 @@
       <xsl:call-template name="level2">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
       </xsl:call-template>
     </xsl:if>
   </xsl:template>
@@ -287,6 +473,7 @@
   <xsl:template name="level23">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
     <xsl:param name="vaddress" select="0"/>
     <xsl:param name="endaddress" select="0"/>
     <xsl:if test="$endaddress > $vaddress">
@@ -301,13 +488,24 @@
       </xsl:call-template>
       <xsl:text> */ </xsl:text>
       <xsl:choose>
-        <xsl:when test="$nextaddress > ext:node-set($pages)/virtual_page[1]/virt">
-          <xsl:text>PTD(</xsl:text>
-          <xsl:value-of select="$name"/>
-          <xsl:text>_</xsl:text>
+        <xsl:when test="ext:node-set($chunks)/chunk[context = $name][size = 262144][base = $vaddress][large = 'true']">
+          <xsl:text>PTE(</xsl:text>
           <xsl:call-template name="toHex">
-            <xsl:with-param name="num" select="ext:node-set($pages)/virtual_page[1]/virt"/>
+            <xsl:with-param name="num" select="ext:node-set($pages)/virtual_page[1]/phys"/>
           </xsl:call-template>
+          <xsl:text>, </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/cache"/>
+          <xsl:text>, </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/protection"/>
+          <xsl:text>), /* </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/partition"/>
+          <xsl:text>.</xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/name"/>
+          <xsl:text> 256KB page */ </xsl:text>
+        </xsl:when>
+        <xsl:when test="$nextaddress > ext:node-set($pages)/virtual_page[1]/virt">
+          <xsl:text>PTD(</xsl:text>
+          <xsl:value-of select="ext:node-set($chunks)/chunk[context = $name][size = 262144][base = $vaddress]/table"/>
           <xsl:text>_level3),</xsl:text>
         </xsl:when>
         <xsl:otherwise>
@@ -325,6 +523,7 @@
       <xsl:call-template name="level23">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
         <xsl:with-param name="vaddress" select="$nextaddress"/>
         <xsl:with-param name="endaddress" select="$endaddress"/>
       </xsl:call-template>
@@ -334,6 +533,7 @@
   <xsl:template name="level1">
     <xsl:param name="pages"/>
     <xsl:param name="name"/>
+    <xsl:param name="chunks"/>
     <xsl:param name="vaddress" select="0"/>
     <xsl:if test="4294967296 > $vaddress">
       <xsl:variable name="nextaddress" select="$vaddress + 16777216"/>
@@ -347,13 +547,24 @@
       </xsl:call-template>
       <xsl:text> */ </xsl:text>
       <xsl:choose>
-        <xsl:when test="$nextaddress > ext:node-set($pages)/virtual_page[1]/virt">
-          <xsl:text>PTD(</xsl:text>
-          <xsl:value-of select="$name"/>
-          <xsl:text>_</xsl:text>
+        <xsl:when test="ext:node-set($chunks)/chunk[context = $name][size = 16777216][base = $vaddress][large = 'true']">
+          <xsl:text>PTE(</xsl:text>
           <xsl:call-template name="toHex">
-            <xsl:with-param name="num" select="ext:node-set($pages)/virtual_page[1]/virt"/>
+            <xsl:with-param name="num" select="ext:node-set($pages)/virtual_page[1]/phys"/>
           </xsl:call-template>
+          <xsl:text>, </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/cache"/>
+          <xsl:text>, </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/protection"/>
+          <xsl:text>), /* </xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/partition"/>
+          <xsl:text>.</xsl:text>
+          <xsl:value-of select="ext:node-set($pages)/virtual_page[1]/name"/>
+          <xsl:text> 16MB page */ </xsl:text>
+        </xsl:when>
+        <xsl:when test="$nextaddress > ext:node-set($pages)/virtual_page[1]/virt">
+          <xsl:text>PTD(</xsl:text>
+          <xsl:value-of select="ext:node-set($chunks)/chunk[context = $name][size = 16777216][base = $vaddress]/table"/>
           <xsl:text>_level2),</xsl:text>
         </xsl:when>
         <xsl:otherwise>
@@ -371,6 +582,7 @@
       <xsl:call-template name="level1">
         <xsl:with-param name="pages" select="$tail"/>
         <xsl:with-param name="name" select="$name"/>
+        <xsl:with-param name="chunks" select="$chunks"/>
         <xsl:with-param name="vaddress" select="$nextaddress"/>
       </xsl:call-template>
     </xsl:if>